@@ -150,7 +150,7 @@ GestureApp::GestureApp()
 	}
 	
 	mDevice = Device::create();
-	mDevice->connectEventHandler( [ & ]( Leap::Frame frame )
+	mDevice->connectEventHandler( [ & ]( const Leap::Frame& frame )
 	{
 		mFrame = frame;
 	} );
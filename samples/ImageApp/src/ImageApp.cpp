@@ -37,7 +37,9 @@
 #include "cinder/app/App.h"
 #include "cinder/Camera.h"
 #include "cinder/params/Params.h"
+#include "BlobTracker.h"
 #include "Cinder-LeapMotion.h"
+#include "ImagePyramid.h"
 
 class ImageApp : public ci::app::App
 {
@@ -47,11 +49,16 @@ public:
 	void						draw() override;
 	void						update() override;
 private:
+	LeapMotion::BlobTrackerRef	mBlobTracker;
 	LeapMotion::DeviceRef		mDevice;
 	Leap::Frame					mFrame;
+	LeapMotion::PolicySubscriptionRef	mImages;
+	LeapMotion::HandRegionServiceRef	mRegions;
 
 	float						mFrameRate;
 	bool						mFullScreen;
+	bool						mShowBlobs;
+	bool						mShowImages;
 	ci::params::InterfaceGlRef	mParams;
 	void						screenShot();
 };
@@ -70,17 +77,21 @@ ImageApp::ImageApp()
 {
 	mFrameRate = 0.0f;
 	mFullScreen = false;
+	mShowBlobs = false;
+	mShowImages = true;
 
-	mDevice = Device::create();
-	mDevice->getController()->setPolicyFlags( Leap::Controller::POLICY_IMAGES );
-	mDevice->connectEventHandler( [ &]( Leap::Frame frame )
+	mDevice		= Device::create();
+	mRegions	= HandRegionService::create();
+	mDevice->connectEventHandler( [ &]( const Leap::Frame& frame )
 	{
 		mFrame = frame;
 	} );
 
-	mParams = params::InterfaceGl::create( "Params", ivec2( 200, 105 ) );
+	mParams = params::InterfaceGl::create( "Params", ivec2( 200, 120 ) );
 	mParams->addParam( "Frame rate",	&mFrameRate,				"", true );
 	mParams->addParam( "Full screen",	&mFullScreen ).key( "f" );
+	mParams->addParam( "Show blobs",	&mShowBlobs ).key( "b" );
+	mParams->addParam( "Show images",	&mShowImages ).key( "i" );
 	mParams->addButton( "Screen shot",	[ & ]() { screenShot(); },	"key=space" );
 	mParams->addButton( "Quit",			[ & ]() { quit(); },		"key=q" );
 
@@ -110,6 +121,24 @@ void ImageApp::draw()
 				gl::translate( x, y );
 				const gl::Texture2dRef tex = gl::Texture::create( *channel );
 				gl::draw( tex, tex->getBounds(), bounds );
+
+				// Overlays are in image pixels
+				const vec2 scale( bounds.getWidth() / (float)img.width(), bounds.getHeight() / (float)img.height() );
+				if ( mBlobTracker ) {
+					const gl::ScopedColor scopedColor( ColorAf( 1.0f, 0.0f, 0.0f, 1.0f ) );
+					const vector<BlobTracker::Blob> blobs = mBlobTracker->getBlobs( img.id() );
+					for ( vector<BlobTracker::Blob>::const_iterator blob = blobs.begin(); blob != blobs.end(); ++blob ) {
+						gl::drawStrokedCircle( blob->mCentroid * scale, math<float>::sqrt( blob->mArea ) * scale.x + 4.0f );
+					}
+				}
+
+				const gl::ScopedColor scopedColor( ColorAf( 0.0f, 0.5f, 1.0f, 1.0f ) );
+				const vector<HandRegionService::Region>& regions = mRegions->getRegions();
+				for ( vector<HandRegionService::Region>::const_iterator region = regions.begin(); region != regions.end(); ++region ) {
+					if ( region->mCamera == img.id() ) {
+						gl::drawStrokedRect( Rectf( vec2( region->mMin ) * scale, vec2( region->mMax ) * scale ) );
+					}
+				}
 			}
 			x += bounds.getWidth();
 		}
@@ -130,6 +159,22 @@ void ImageApp::update()
 	if ( mFullScreen != isFullScreen() ) {
 		setFullScreen( mFullScreen );
 	}
+
+	mRegions->update( mFrame );
+
+	// Images cost bandwidth, so only hold the policy while they're shown
+	if ( mShowImages && !mImages ) {
+		mImages = mDevice->subscribeImages();
+	} else if ( !mShowImages && mImages ) {
+		mImages.reset();
+	}
+
+	// Blobs are found on the tracker's own thread
+	if ( mShowBlobs && !mBlobTracker ) {
+		mBlobTracker = BlobTracker::create( mDevice );
+	} else if ( !mShowBlobs && mBlobTracker ) {
+		mBlobTracker.reset();
+	}
 }
 
 RendererGl::Options gOptions;
@@ -49,7 +49,7 @@ public:
 private:
 	LeapMotion::DeviceRef		mDevice;
 	Leap::Frame					mFrame;
-	void 						onFrame( Leap::Frame frame );
+	void 						onFrame( const Leap::Frame& frame );
 
 	ci::CameraPersp				mCamera;
 
@@ -194,7 +194,7 @@ void LeapApp::draw()
 	mParams->draw();
 }
 
-void LeapApp::onFrame( Leap::Frame frame )
+void LeapApp::onFrame( const Leap::Frame& frame )
 {
 	mFrame = frame;
 }
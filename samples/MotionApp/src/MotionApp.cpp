@@ -55,7 +55,7 @@ private:
 	
 	Leap::Frame					mFrame;
 	LeapMotion::DeviceRef		mDevice;
-	void						onFrame( Leap::Frame frame );
+	void						onFrame( const Leap::Frame& frame );
 	
 	float						mRotAngle;
 	ci::vec3					mRotAxis;
@@ -132,7 +132,7 @@ void MotionApp::draw()
 	mParams->draw();
 }
 
-void MotionApp::onFrame( Leap::Frame frame )
+void MotionApp::onFrame( const Leap::Frame& frame )
 {
 	const Leap::HandList& hands = frame.hands();
 	for ( Leap::HandList::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
@@ -38,6 +38,7 @@
 #include "cinder/Camera.h"
 #include "cinder/params/Params.h"
 #include "Cinder-LeapMotion.h"
+#include "HandRenderer.h"
 
 class SkeletalApp : public ci::app::App
 {
@@ -48,6 +49,7 @@ public:
 private:
 	LeapMotion::DeviceRef		mDevice;
 	Leap::Frame					mFrame;
+	LeapMotion::HandRendererRef	mHandRenderer;
 
 	ci::CameraPersp				mCamera;
 
@@ -76,51 +78,8 @@ void SkeletalApp::draw()
 	gl::enableAlphaBlending();
 	gl::enableDepthRead();
 	gl::enableDepthWrite();
-	gl::color( ColorAf::black() );
-
-	const Leap::HandList& hands = mFrame.hands();
-	for ( Leap::HandList::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
-		const Leap::Hand& hand	= *handIter;
-		const Leap::Arm& arm	= hand.arm();
-		
-		vec3 palm				= LeapMotion::toVec3( hand.palmPosition() );
-		vec3 elbow				= LeapMotion::toVec3( arm.elbowPosition() );
-		vec3 rotation			= vec3( hand.direction().pitch(), hand.direction().yaw(), hand.palmNormal().roll() );
-		vec3 wrist				= LeapMotion::toVec3( arm.wristPosition() );
-
-		gl::drawLine( elbow, wrist );
-
-		vector<vec3> knuckles;
-		const Leap::FingerList fingers = hand.fingers();
-		for ( Leap::FingerList::const_iterator fingerIter = fingers.begin(); fingerIter != fingers.end(); ++fingerIter ) {
-			const Leap::Finger& finger = *fingerIter;
-
-			for ( int32_t i = 0; i < 4; ++i ) {
-				const Leap::Bone& bone = finger.bone( (Leap::Bone::Type)i );
-				vec3 center		= LeapMotion::toVec3( bone.center() );
-				vec3 direction	= LeapMotion::toVec3( bone.direction() );
-				vec3 start		= center - direction * bone.length() * 0.5f;
-				vec3 end		= center + direction * bone.length() * 0.5f;
-				
-				if ( i == 0 ) {
-					knuckles.push_back( start );
-					gl::drawLine( wrist, start );
-				} else {
-					gl::drawLine( start, end );
-				}
-			}
-		}
-
-		if ( knuckles.size() > 1 ) {
-			for ( size_t i = 1; i < knuckles.size(); ++i ) {
-				const vec3& v0 = knuckles.at( i - 1 );
-				const vec3& v1 = knuckles.at( i );
-				gl::drawLine( v0, v1 );
-			}
-			gl::drawLine( elbow, knuckles.at( 0 ) );
-		}
 
-	}
+	mHandRenderer->draw();
 
 	mParams->draw();
 }
@@ -135,8 +94,10 @@ void SkeletalApp::setup()
 	mCamera = CameraPersp( getWindowWidth(), getWindowHeight(), 60.0f, 1.0f, 5000.0f );
 	mCamera.lookAt( vec3( 0.0f, 300.0f, 300.0f ), vec3( 0.0f, 250.0f, 0.0f ) );
 	
+	mHandRenderer = HandRenderer::create();
+
 	mDevice = Device::create();
-	mDevice->connectEventHandler( [ & ]( Leap::Frame frame )
+	mDevice->connectEventHandler( [ & ]( const Leap::Frame& frame )
 	{
 		mFrame = frame;
 	} );
@@ -163,6 +124,8 @@ void SkeletalApp::update()
 	if ( mFullScreen != isFullScreen() ) {
 		setFullScreen( mFullScreen );
 	}
+
+	mHandRenderer->update( mFrame );
 }
 
 RendererGl::Options gOptions;
@@ -37,24 +37,38 @@
 #pragma once
 
 #include "cinder/Color.h"
+#include "cinder/gl/Vao.h"
+#include "cinder/gl/Vbo.h"
 #include "cinder/Vector.h"
-#include <map>
 #include <vector>
 
-typedef std::map<int32_t, class Ribbon> RibbonMap;
-
+/*! A fading trail of points. Points live in a fixed-capacity ring 
+	buffer, so aging out is O(1). Drawn through a RibbonBatch, which 
+	writes the triangle strip straight into a shared streaming VBO. */
 class Ribbon
 {
 public:
-	Ribbon( int32_t id = 0, const ci::Colorf& color = ci::Colorf::white() );
+	struct Vertex
+	{
+		ci::vec3			mPosition;
+		ci::vec4			mColor;
+	};
+
+	Ribbon( int32_t id = 0, const ci::Colorf& color = ci::Colorf::white(), size_t capacity = 128 );
 	~Ribbon();
 
+	//! Appends a point. Oldest point is overwritten when ribbon is full.
 	void					addPoint( const ci::vec3& position, float width = 1.0f );
-	void					draw() const;
 	void					update();
+	//! Writes the triangle strip to \a vertices, getNumVertices() long.
+	void					write( Vertex* vertices ) const;
 	
+	size_t					getCapacity() const;
 	const ci::Colorf&		getColor() const;
 	int32_t					getId() const;
+	size_t					getNumPoints() const;
+	//! Returns strip length, or zero while too short to draw.
+	size_t					getNumVertices() const;
 private:
 	struct Point
 	{
@@ -64,8 +78,43 @@ private:
 		float				mWidth;
 	};
 
+	Point&					at( size_t i );
+	const Point&			at( size_t i ) const;
+
 	ci::Colorf				mColor;
+	size_t					mCount;
+	size_t					mHead;
 	int32_t					mId;
+	size_t					mMask;
 	std::vector<Point>		mPoints;
-	std::vector<ci::vec3>	mPositions;
+};
+
+/*! Draws ribbons with one glMultiDrawArrays() call. Strips are streamed 
+	into a VBO split into three regions used in turn. Each region is 
+	mapped unsynchronized and fenced after its draw, so the CPU only 
+	waits if the GPU is still reading the region from three frames ago. */
+class RibbonBatch
+{
+public:
+	RibbonBatch();
+	~RibbonBatch();
+
+	//! Queues \a ribbon for the next draw(). \a ribbon must not change before then.
+	void					add( const Ribbon& ribbon );
+	//! Draws and clears queued ribbons.
+	void					draw();
+private:
+	static const size_t		kNumRegions = 3;
+
+	//! Reallocates the VBO with room for \a numVertices per region.
+	void					reserve( size_t numVertices );
+
+	std::vector<GLsizei>	mCounts;
+	GLsync					mFences[ kNumRegions ];
+	std::vector<GLint>		mFirsts;
+	size_t					mRegion;
+	size_t					mRegionSize;
+	std::vector<const Ribbon*>	mRibbons;
+	ci::gl::VaoRef			mVao;
+	ci::gl::VboRef			mVbo;
 };
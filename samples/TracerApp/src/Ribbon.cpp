@@ -39,6 +39,8 @@
 #include "cinder/app/App.h"
 #include "cinder/gl/gl.h"
 #include "cinder/Utilities.h"
+#include <algorithm>
+#include <cstddef>
 
 using namespace ci;
 using namespace ci::app;
@@ -51,26 +53,54 @@ Ribbon::Point::Point( const vec3& position, float width )
 	mWidth		= width;
 }
 
-Ribbon::Ribbon( int32_t id, const Colorf& color )
+Ribbon::Ribbon( int32_t id, const Colorf& color, size_t capacity )
 {
-	mColor	= color;
-	mId		= id;
+	// Round capacity up to a power of two so ring indices can be masked
+	size_t n = 2;
+	while ( n < capacity ) {
+		n <<= 1;
+	}
+
+	mColor			= color;
+	mCount			= 0;
+	mHead			= 0;
+	mId				= id;
+	mMask			= n - 1;
+	mPoints.resize( n );
 }
 
 Ribbon::~Ribbon()
 {
-	mPoints.clear();
+}
+
+Ribbon::Point& Ribbon::at( size_t i )
+{
+	return mPoints[ ( mHead + i ) & mMask ];
+}
+
+const Ribbon::Point& Ribbon::at( size_t i ) const
+{
+	return mPoints[ ( mHead + i ) & mMask ];
 }
 
 void Ribbon::addPoint( const vec3& position, float width )
 {
 	vec3 p( position );
-	if ( !mPoints.empty() ) {
-		p = glm::mix( mPoints.back().mPosition, position, vec3( 0.15f ) );
+	if ( mCount > 0 ) {
+		p = glm::mix( at( mCount - 1 ).mPosition, position, vec3( 0.15f ) );
 	}
 
-	Point point( p, width );
-	mPoints.push_back( point );
+	if ( mCount == mPoints.size() ) {
+		mHead = ( mHead + 1 ) & mMask;
+		--mCount;
+	}
+	at( mCount ) = Point( p, width );
+	++mCount;
+}
+
+size_t Ribbon::getCapacity() const
+{
+	return mPoints.size();
 }
 
 const Colorf& Ribbon::getColor() const
@@ -83,72 +113,172 @@ int32_t Ribbon::getId() const
 	return mId;
 }
 
-void Ribbon::draw() const
+size_t Ribbon::getNumPoints() const
+{
+	return mCount;
+}
+
+size_t Ribbon::getNumVertices() const
+{
+	return mCount >= 3 ? ( mCount - 1 ) * 2 : 0;
+}
+
+void Ribbon::update()
+{
+	// Age points in place. Points are only released from the oldest end, 
+	// so a point which runs out of width early collapses to zero width 
+	// until it becomes the oldest.
+	float e = getElapsedSeconds() * 40.0f;
+	for ( size_t i = 0; i < mCount; ++i ) {
+		Point& point		= at( i );
+		point.mAlpha		-= 0.01f;
+		point.mWidth		= math<float>::max( point.mWidth - 0.125f, 0.0f );
+		float t				= powf( (float)i, 2.0f ) + e;
+		point.mPosition.x	+= cosf( t ) * 0.3f;
+		point.mPosition.y	+= sinf( t ) * 0.5f;
+	}
+	while ( mCount > 0 && ( at( 0 ).mAlpha <= 0.0f || at( 0 ).mWidth <= 0.0f ) ) {
+		mHead = ( mHead + 1 ) & mMask;
+		--mCount;
+	}
+}
+
+void Ribbon::write( Vertex* vertex ) const
 {
-	size_t count = mPoints.size();
-	if ( count < 2 ) {
+	if ( getNumVertices() == 0 ) {
 		return;
 	}
+	for ( size_t i = 0; i < mCount - 1; ++i ) {
+		const Point& a	= at( i );
+		const Point& b	= at( i + 1 );
+
+		vec3 pos0	= a.mPosition;
+		vec3 pos1	= b.mPosition;
+		vec3 dir0	= pos0 - pos1;
+		dir0.z		= 0.0f;
+		vec3 dir1	= glm::cross( dir0, vec3( 0.0f, 0.0f, 1.0f ) );
+		vec3 dir2	= glm::cross( dir0, dir1 );
+		dir1		= glm::normalize( glm::cross( dir0, dir2 ) );
+		vec3 offset	= dir1 * a.mWidth;
+		vec4 color( mColor.r, mColor.g, mColor.b, a.mAlpha );
+
+		vertex->mPosition	= pos0 - offset;
+		vertex->mColor		= color;
+		++vertex;
+		vertex->mPosition	= pos0 + offset;
+		vertex->mColor		= color;
+		++vertex;
+	}
+}
 
-	gl::begin( GL_TRIANGLES );
-	for ( size_t i = 0; i < count - 2; ++i ) {
-        uint32_t index = i * 2;
+//////////////////////////////////////////////////////////////////////////////////////////////
 
-		vec3 pos0 = mPositions.at( index + 0 );
-		vec3 pos1 = mPositions.at( index + 1 );
-		vec3 pos2 = mPositions.at( index + 2 );
-		vec3 pos3 = mPositions.at( index + 3 );
+RibbonBatch::RibbonBatch()
+{
+	for ( size_t i = 0; i < kNumRegions; ++i ) {
+		mFences[ i ] = nullptr;
+	}
+	mRegion		= 0;
+	mRegionSize	= 0;
+}
+
+RibbonBatch::~RibbonBatch()
+{
+	for ( size_t i = 0; i < kNumRegions; ++i ) {
+		if ( mFences[ i ] != nullptr ) {
+			glDeleteSync( mFences[ i ] );
+		}
+	}
+}
 
-		ColorAf color( mColor, mPoints.at( i ).mAlpha );
-		gl::color( color );
-		
-		gl::vertex( pos0 );
-		gl::vertex( pos2 );
-		gl::vertex( pos1 );
-		gl::vertex( pos1 );
-		gl::vertex( pos2 );
-		gl::vertex( pos3 );
-    }
-	gl::end();
+void RibbonBatch::add( const Ribbon& ribbon )
+{
+	if ( ribbon.getNumVertices() > 0 ) {
+		mRibbons.push_back( &ribbon );
+	}
 }
 
-void Ribbon::update()
+void RibbonBatch::draw()
 {
-	float e = getElapsedSeconds() * 40.0f;
-	float i = 0.0f;
-	for ( vector<Point>::iterator iter = mPoints.begin(); iter != mPoints.end(); i += 1.0f ) {
-		iter->mAlpha		-= 0.01f;
-		iter->mWidth		-= 0.125f;
-		float t				= powf( i, 2.0f ) + e;
-		iter->mPosition.x	+= cosf( t ) * 0.3f;
-		iter->mPosition.y	+= sinf( t ) * 0.5f;
-
-		if ( iter->mAlpha <= 0.0f || iter->mWidth <= 0.0f ) {
-			iter = mPoints.erase( iter );
-		} else {
-			++iter;
+	size_t numVertices = 0;
+	for ( vector<const Ribbon*>::const_iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
+		numVertices += ( *iter )->getNumVertices();
+	}
+	if ( numVertices == 0 ) {
+		return;
+	}
+	if ( numVertices > mRegionSize ) {
+		reserve( numVertices );
+	}
+
+	// Wait out the draw which last read this region. Three frames on, 
+	// the fence has nearly always signalled.
+	mRegion = ( mRegion + 1 ) % kNumRegions;
+	if ( mFences[ mRegion ] != nullptr ) {
+		GLenum result = GL_TIMEOUT_EXPIRED;
+		while ( result == GL_TIMEOUT_EXPIRED ) {
+			result = glClientWaitSync( mFences[ mRegion ], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
 		}
+		glDeleteSync( mFences[ mRegion ] );
+		mFences[ mRegion ] = nullptr;
+	}
+
+	// The region is idle, so map it without the driver's implicit sync
+	size_t first				= mRegion * mRegionSize;
+	Ribbon::Vertex* vertex		= (Ribbon::Vertex*)mVbo->mapBufferRange( first * sizeof( Ribbon::Vertex ), 
+		numVertices * sizeof( Ribbon::Vertex ), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+	if ( vertex == nullptr ) {
+		mRibbons.clear();
+		return;
 	}
+	mCounts.clear();
+	mFirsts.clear();
+	for ( vector<const Ribbon*>::const_iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
+		size_t count = ( *iter )->getNumVertices();
+		( *iter )->write( vertex );
+		mCounts.push_back( (GLsizei)count );
+		mFirsts.push_back( (GLint)first );
+		first	+= count;
+		vertex	+= count;
+	}
+	mVbo->unmap();
+	mRibbons.clear();
+
+	const gl::ScopedGlslProg scopedGlslProg( gl::getStockShader( gl::ShaderDef().color() ) );
+	const gl::ScopedVao scopedVao( mVao );
+	gl::setDefaultShaderVars();
+	glMultiDrawArrays( GL_TRIANGLE_STRIP, &mFirsts[ 0 ], &mCounts[ 0 ], (GLsizei)mCounts.size() );
+	mFences[ mRegion ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
 
-	mPositions.clear();
-	size_t count = mPoints.size();
-	if ( count >= 2 ) {
-		for ( size_t i = 0; i < count - 1; ++i ) {
-			const Point& a	= mPoints.at( i );
-			const Point& b	= mPoints.at( i + 1 );
-
-			vec3 pos0	= a.mPosition;
-			vec3 pos1	= b.mPosition;
-			vec3 dir0	= pos0 - pos1;
-			dir0.z		= 0.0f;
-			vec3 dir1	= glm::cross( dir0, vec3( 0.0f, 0.0f, 1.0f ) );
-			vec3 dir2	= glm::cross( dir0, dir1 );
-			dir1		= glm::normalize( glm::cross( dir0, dir2 ) );
-			vec3 offset	= dir1 * a.mWidth;
-
-			mPositions.push_back( pos0 - offset );
-			mPositions.push_back( pos0 + offset );
+void RibbonBatch::reserve( size_t numVertices )
+{
+	// Draws in flight keep the old buffer alive, so its fences can go
+	for ( size_t i = 0; i < kNumRegions; ++i ) {
+		if ( mFences[ i ] != nullptr ) {
+			glDeleteSync( mFences[ i ] );
+			mFences[ i ] = nullptr;
 		}
 	}
+
+	// Grow in powers of two so ribbons lengthening a point at a time 
+	// do not reallocate every frame
+	mRegionSize = max( mRegionSize, (size_t)1024 );
+	while ( mRegionSize < numVertices ) {
+		mRegionSize <<= 1;
+	}
+	mVbo = gl::Vbo::create( GL_ARRAY_BUFFER, kNumRegions * mRegionSize * sizeof( Ribbon::Vertex ), nullptr, GL_STREAM_DRAW );
+
+	mVao = gl::Vao::create();
+	const gl::ScopedVao scopedVao( mVao );
+	const gl::ScopedBuffer scopedBuffer( mVbo );
+	gl::GlslProgRef glsl	= gl::getStockShader( gl::ShaderDef().color() );
+	GLint position			= glsl->getAttribSemanticLocation( geom::Attrib::POSITION );
+	GLint color				= glsl->getAttribSemanticLocation( geom::Attrib::COLOR );
+	gl::enableVertexAttribArray( position );
+	gl::vertexAttribPointer( position, 3, GL_FLOAT, GL_FALSE, sizeof( Ribbon::Vertex ), 
+		(const GLvoid*)offsetof( Ribbon::Vertex, mPosition ) );
+	gl::enableVertexAttribArray( color );
+	gl::vertexAttribPointer( color, 4, GL_FLOAT, GL_FALSE, sizeof( Ribbon::Vertex ), 
+		(const GLvoid*)offsetof( Ribbon::Vertex, mColor ) );
 }
- 
\ No newline at end of file
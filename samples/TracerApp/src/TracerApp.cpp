@@ -50,10 +50,13 @@ public:
 	void						resize() override;
 	void						update() override;
 private:
-	RibbonMap					mRibbons;
+	RibbonBatch					mRibbonBatch;
+	LeapMotion::TrackingMap<Ribbon>	mRibbons;
 
 	Leap::Frame					mFrame;
+	int64_t						mFrameId;
 	LeapMotion::DeviceRef		mDevice;
+	LeapMotion::HandIdentityTracker	mHandIds;
 	
 	ci::gl::BatchRef			mBatchBlur;
 	ci::gl::FboRef				mFbo[ 3 ];
@@ -79,7 +82,9 @@ using namespace ci::app;
 using namespace LeapMotion;
 using namespace std;
 TracerApp::TracerApp()
+: mRibbons( 120 )
 {
+	mFrameId = -1;
 	mFrameRate = 0.0f;
 	mFullScreen = isFullScreen();
 
@@ -87,7 +92,7 @@ TracerApp::TracerApp()
 	mCamera.lookAt( vec3( 0.0f, 93.75f, 250.0f ), vec3( 0.0f, 250.0f, 0.0f ) );
 
 	mDevice = Device::create();
-	mDevice->connectEventHandler( [ & ]( Leap::Frame frame )
+	mDevice->connectEventHandler( [ & ]( const Leap::Frame& frame )
 	{
 		mFrame = frame;
 	} );
@@ -144,9 +149,10 @@ void TracerApp::draw()
 			const gl::ScopedMatrices scopedMatrices;
 			const gl::ScopedBlendAdditive scopedBlendAdditive;
 			gl::setMatrices( mCamera );
-			for ( RibbonMap::const_iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
-				iter->second.draw();
+			for ( TrackingMap<Ribbon>::const_iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
+				mRibbonBatch.add( *iter );
 			}
+			mRibbonBatch.draw();
 		}
 	}
 
@@ -214,36 +220,49 @@ void TracerApp::update()
 		mFullScreen = isFullScreen();
 	}
 
-	// Process hand data
+	// Update ribbons. Points fade every render frame.
+	for ( TrackingMap<Ribbon>::iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
+		iter->update();
+	}
+
+	// Hand data, identities and ribbon expiry only advance when the 
+	// device has delivered a new frame since the last update.
+	if ( !mFrame.isValid() || mFrame.id() == mFrameId ) {
+		return;
+	}
+	mFrameId = mFrame.id();
+
+	// Process hand data. Ribbons are keyed by stable hand id, so they 
+	// carry on when the SDK reassigns ids after a tracking dropout.
+	mHandIds.update( mFrame );
 	const Leap::HandList& hands = mFrame.hands();
 	for ( Leap::HandList::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
-		const Leap::Hand& hand = *handIter;
+		const Leap::Hand& hand	= *handIter;
+		int32_t handId			= mHandIds.getStableId( hand.id() );
 		
 		const Leap::FingerList& fingers = hand.fingers();
 		for ( Leap::FingerList::const_iterator iter = fingers.begin(); iter != fingers.end(); ++iter ) {
 			const Leap::Finger& finger = *iter;
 			if ( finger.isExtended() ) {
-				int32_t id = finger.id();
-				if ( mRibbons.find( id ) == mRibbons.end() ) {
+				int32_t id		= handId * 5 + (int32_t)finger.type();
+				Ribbon* ribbon	= mRibbons.touch( id );
+				if ( ribbon == nullptr ) {
 					vec3 v = randVec3();
 					v.x = math<float>::abs( v.x );
 					v.y = math<float>::abs( v.y );
 					v.z = math<float>::abs( v.z );
 					Colorf color( ColorModel::CM_RGB, v );
-					Ribbon ribbon( id, color );
-					mRibbons[ id ] = ribbon;
+					ribbon = &mRibbons.insert( id, Ribbon( id, color ) );
 				}
 				float width = math<float>::abs( finger.tipVelocity().y ) * 0.00075f;
 				width		= math<float>::max( width, 2.0f );
-				mRibbons.at( id ).addPoint( LeapMotion::toVec3( finger.tipPosition() ), width );
+				ribbon->addPoint( LeapMotion::toVec3( finger.tipPosition() ), width );
 			}
 		}
 	}
 
-	// Update ribbons
-	for ( RibbonMap::iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
-		iter->second.update();
-	}
+	// Ribbons whose finger has been gone long enough to fade out are released
+	mRibbons.update();
 }
 
 RendererGl::Options gOptions;
@@ -48,10 +48,11 @@ public:
 	void						resize() override;
 	void						update() override;
 private:
-	Leap::Frame					mFrame;
 	LeapMotion::DeviceRef		mDevice;
-	ci::vec2					warpPointable( const Leap::Pointable& p );
-	ci::vec2					warpVector( const Leap::Vector& v );
+	LeapMotion::FieldSubscriptionRef	mFields;
+	LeapMotion::FrameSnapshot	mFrame;
+	ci::vec2					warpPointable( const LeapMotion::FingerSnapshot& f );
+	ci::vec2					warpVector( const ci::vec3& v );
 
 	enum
 	{
@@ -94,10 +95,7 @@ using namespace std;
 UiApp::UiApp()
 {
 	mDevice 		= Device::create();
-	mDevice->connectEventHandler( [ & ]( Leap::Frame frame )
-	{
-		mFrame = frame;
-	} );
+	mFields			= mDevice->subscribeFields( FIELD_PALMS | FIELD_TIPS );
 
 	for ( size_t i = 0; i < 3; ++i ) {
 		switch ( (CursorType)i ) {
@@ -230,21 +228,32 @@ void UiApp::update()
 		setFullScreen( mFullScreen );
 	}
 
+	// Sample one frame interval back so there is always a newer 
+	// frame to blend toward. The cursor then moves every vsync.
+	mFrame = mDevice->getSnapshot( mDevice->now() - mDevice->getFrameInterval() );
+
 	// Interact with first hand only
-	const Leap::HandList& hands = mFrame.hands();
-	if ( hands.isEmpty() ) {
+	if ( mFrame.mNumHands == 0 ) {
 		mCursorType = CursorType::NONE;
 	} else {
-		const Leap::Hand& hand = *hands.begin();
+		const HandSnapshot& hand = mFrame.mHands[ 0 ];
 		
 		// Update cursor position
-		mCursorPositionTarget	= warpVector( hand.stabilizedPalmPosition() );
+		mCursorPositionTarget	= warpVector( hand.mStabilizedPalmPosition );
 		if ( mCursorType == CursorType::NONE ) {
 			mCursorPosition = mCursorPositionTarget;
 		}
 		
 		// Choose cursor type based on number of extended fingers
-		switch ( hand.fingers().extended().count() ) {
+		const FingerSnapshot* extended	= nullptr;
+		size_t numExtended				= 0;
+		for ( size_t i = 0; i < 5; ++i ) {
+			if ( hand.mFingers[ i ].mExtended ) {
+				extended = &hand.mFingers[ i ];
+				++numExtended;
+			}
+		}
+		switch ( numExtended ) {
 			case 0:
 				mCursorType	= CursorType::GRAB;
 				
@@ -259,7 +268,7 @@ void UiApp::update()
 				mCursorType	= CursorType::TOUCH;
 				
 				// Buttons
-				mFingerTipPosition = warpPointable( *hand.fingers().begin() );
+				mFingerTipPosition = warpPointable( *extended );
 				for ( size_t i = 0; i < 3; ++i ) {
 					mButtonState[ i ] = false;
 					if ( mButton[ 0 ]->getBounds().contains( mFingerTipPosition - mButtonPosition[ i ] ) ) {
@@ -277,26 +286,25 @@ void UiApp::update()
 	mCursorPosition = lerp<vec2>( mCursorPosition, mCursorPositionTarget, 0.21f );
 }
 
-vec2 UiApp::warpPointable( const Leap::Pointable& p )
+vec2 UiApp::warpPointable( const FingerSnapshot& f )
 {
 	vec3 result( 0.0f );
 	if ( mDevice ) {
-		const Leap::Screen& screen = mDevice->getController()->locatedScreens().closestScreenHit( p );
-		
-		result	= LeapMotion::toVec3( screen.intersect( p, true, 1.0f ) );
+		vec3 position	= f.mTipPosition;
+		vec3 direction	= f.mDirection;
+		mDevice->getScreenCalibration().intersect( &position, &direction, 1, &result, true, 1.0f );
 	}
 	result		*= vec3( vec2( getWindowSize() ), 0.0f );
 	result.y	= (float)getWindowHeight() - result.y;
 	return vec2( result.x, result.y );
 }
 
-vec2 UiApp::warpVector( const Leap::Vector& v )
+vec2 UiApp::warpVector( const vec3& v )
 {
 	vec3 result( 0.0f );
 	if ( mDevice ) {
-		const Leap::Screen& screen = mDevice->getController()->locatedScreens().closestScreen( v );
-		
-		result	= LeapMotion::toVec3( screen.project( v, true ) );
+		vec3 position = v;
+		mDevice->getScreenCalibration().project( &position, 1, &result, true );
 	}
 	result		*= vec3( getWindowSize(), 0.0f );
 	result.y	= (float)getWindowHeight() - result.y;
@@ -0,0 +1,359 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "BlobTracker.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <climits>
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+BlobTracker::Options::Options()
+: mMaxArea( 0 ), mMaxDistance( 16.0f ), mMinArea( 3 ), mThreshold( 200 )
+{
+}
+
+BlobTrackerRef BlobTracker::create( const Options& options )
+{
+	return BlobTrackerRef( new BlobTracker( options ) );
+}
+
+BlobTrackerRef BlobTracker::create( const DeviceRef& device, const Options& options )
+{
+	BlobTrackerRef tracker( new BlobTracker( options ) );
+	BlobTracker* t = tracker.get();
+
+	// The subscription is disconnected (and its thread joined) before the tracker goes away
+	tracker->mImages		= device->subscribeImages();
+	// Frames without images are skipped in the handler rather than by a 
+	// filter, so nothing runs on the SDK thread on the tracker's behalf
+	tracker->mSubscription	= device->subscribe( [ t ]( const Leap::Frame& frame )
+	{
+		if ( !frame.images().isEmpty() ) {
+			t->update( frame );
+		}
+	}, EXECUTOR_WORKER );
+	return tracker;
+}
+
+BlobTracker::BlobTracker( const Options& options )
+: mNextId( 0 ), mOptions( options )
+{
+}
+
+BlobTracker::~BlobTracker()
+{
+	if ( mSubscription ) {
+		mSubscription->disconnect();
+	}
+}
+
+const BlobTracker::Options& BlobTracker::getOptions() const
+{
+	return mOptions;
+}
+
+vector<BlobTracker::Blob> BlobTracker::getBlobs() const
+{
+	lock_guard<mutex> lock( mMutex );
+	return mBlobs;
+}
+
+vector<BlobTracker::Blob> BlobTracker::getBlobs( int32_t camera ) const
+{
+	vector<Blob> blobs;
+	lock_guard<mutex> lock( mMutex );
+	for ( vector<Blob>::const_iterator iter = mBlobs.begin(); iter != mBlobs.end(); ++iter ) {
+		if ( iter->mCamera == camera ) {
+			blobs.push_back( *iter );
+		}
+	}
+	return blobs;
+}
+
+void BlobTracker::update( const Leap::Frame& frame )
+{
+	const Leap::ImageList& images = frame.images();
+	for ( Leap::ImageList::const_iterator iter = images.begin(); iter != images.end(); ++iter ) {
+		update( *iter );
+	}
+}
+
+void BlobTracker::update( const Leap::Image& image )
+{
+	if ( image.isValid() && image.bytesPerPixel() == 1 ) {
+		update( image.data(), image.width(), image.height(), image.id() );
+	}
+}
+
+void BlobTracker::update( const uint8_t* data, int32_t width, int32_t height, int32_t camera )
+{
+	if ( data == nullptr || width <= 0 || height <= 0 ) {
+		return;
+	}
+	detect( data, width, height, camera );
+	track( camera );
+}
+
+int32_t BlobTracker::find( int32_t label )
+{
+	while ( mParents[ label ] != label ) {
+		mParents[ label ]	= mParents[ mParents[ label ] ];
+		label				= mParents[ label ];
+	}
+	return label;
+}
+
+void BlobTracker::detect( const uint8_t* data, int32_t width, int32_t height, int32_t camera )
+{
+	mDetected.clear();
+	mParents.clear();
+	mRunsPrev.clear();
+	mStats.clear();
+
+	const uint8_t threshold = mOptions.mThreshold;
+#if defined( LEAPMOTION_SSE )
+	const __m128i t = _mm_set1_epi8( (char)threshold );
+#endif
+
+	for ( int32_t y = 0; y < height; ++y ) {
+		const uint8_t* row = data + (size_t)y * width;
+
+		// Find foreground runs. Most of the image is dark, so whole 
+		// chunks of background are skipped with one test.
+		mRuns.clear();
+		int32_t start	= -1;
+		int32_t x		= 0;
+#if defined( LEAPMOTION_SSE )
+		for ( ; x + 16 <= width; x += 16 ) {
+			__m128i v		= _mm_loadu_si128( (const __m128i*)( row + x ) );
+			int32_t mask	= _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_max_epu8( v, t ), v ) );
+			if ( mask == 0 || mask == 0xFFFF ) {
+				if ( ( mask != 0 ) != ( start >= 0 ) ) {
+					if ( start < 0 ) {
+						start = x;
+					} else {
+						Run run = { x - 1, -1, start };
+						mRuns.push_back( run );
+						start = -1;
+					}
+				}
+				continue;
+			}
+			for ( int32_t i = 0; i < 16; ++i ) {
+				bool on = ( ( mask >> i ) & 1 ) != 0;
+				if ( on && start < 0 ) {
+					start = x + i;
+				} else if ( !on && start >= 0 ) {
+					Run run = { x + i - 1, -1, start };
+					mRuns.push_back( run );
+					start = -1;
+				}
+			}
+		}
+#endif
+		for ( ; x < width; ++x ) {
+			bool on = row[ x ] >= threshold;
+			if ( on && start < 0 ) {
+				start = x;
+			} else if ( !on && start >= 0 ) {
+				Run run = { x - 1, -1, start };
+				mRuns.push_back( run );
+				start = -1;
+			}
+		}
+		if ( start >= 0 ) {
+			Run run = { width - 1, -1, start };
+			mRuns.push_back( run );
+		}
+
+		// Label each run from the (8-connected) runs above it, merging 
+		// labels where a run touches more than one
+		size_t p = 0;
+		for ( vector<Run>::iterator run = mRuns.begin(); run != mRuns.end(); ++run ) {
+			while ( p < mRunsPrev.size() && mRunsPrev[ p ].mEnd < run->mStart - 1 ) {
+				++p;
+			}
+			int32_t label = -1;
+			for ( size_t q = p; q < mRunsPrev.size() && mRunsPrev[ q ].mStart <= run->mEnd + 1; ++q ) {
+				int32_t other = find( mRunsPrev[ q ].mLabel );
+				if ( label < 0 ) {
+					label = other;
+				} else if ( other != label ) {
+					mParents[ max( label, other ) ]	= min( label, other );
+					label							= min( label, other );
+				}
+			}
+			if ( label < 0 ) {
+				label = (int32_t)mParents.size();
+				mParents.push_back( label );
+				Stats stats = { 0, -1, -1, INT32_MAX, INT32_MAX, 0, 0, 0, 0, 0, 0 };
+				mStats.push_back( stats );
+			}
+			run->mLabel = label;
+
+			Stats& stats	= mStats[ label ];
+			stats.mCount	+= run->mEnd - run->mStart + 1;
+			stats.mMaxX		= max( stats.mMaxX, run->mEnd );
+			stats.mMaxY		= max( stats.mMaxY, y );
+			stats.mMinX		= min( stats.mMinX, run->mStart );
+			stats.mMinY		= min( stats.mMinY, y );
+			for ( int32_t i = run->mStart; i <= run->mEnd; ++i ) {
+				stats.mSumI		+= row[ i ];
+				stats.mSumX		+= i;
+				stats.mSumXX	+= (int64_t)i * i;
+				stats.mSumXY	+= (int64_t)i * y;
+				stats.mSumY		+= y;
+				stats.mSumYY	+= (int64_t)y * y;
+			}
+		}
+		mRuns.swap( mRunsPrev );
+	}
+
+	// Fold every label's moments into its root
+	for ( int32_t label = 0; label < (int32_t)mParents.size(); ++label ) {
+		int32_t root = find( label );
+		if ( root == label ) {
+			continue;
+		}
+		const Stats& a	= mStats[ label ];
+		Stats& b		= mStats[ root ];
+		b.mCount		+= a.mCount;
+		b.mMaxX			= max( b.mMaxX, a.mMaxX );
+		b.mMaxY			= max( b.mMaxY, a.mMaxY );
+		b.mMinX			= min( b.mMinX, a.mMinX );
+		b.mMinY			= min( b.mMinY, a.mMinY );
+		b.mSumI			+= a.mSumI;
+		b.mSumX			+= a.mSumX;
+		b.mSumXX		+= a.mSumXX;
+		b.mSumXY		+= a.mSumXY;
+		b.mSumY			+= a.mSumY;
+		b.mSumYY		+= a.mSumYY;
+	}
+
+	for ( int32_t label = 0; label < (int32_t)mParents.size(); ++label ) {
+		const Stats& s = mStats[ label ];
+		if ( mParents[ label ] != label || s.mCount < (int64_t)mOptions.mMinArea || 
+			 ( mOptions.mMaxArea > 0 && s.mCount > (int64_t)mOptions.mMaxArea ) ) {
+			continue;
+		}
+		double n	= (double)s.mCount;
+		double x	= (double)s.mSumX / n;
+		double y	= (double)s.mSumY / n;
+
+		Blob blob;
+		blob.mAge			= 0;
+		blob.mArea			= (float)s.mCount;
+		blob.mCamera		= camera;
+		blob.mCentroid		= vec2( (float)x + 0.5f, (float)y + 0.5f );
+		blob.mCovariance	= vec3( (float)( (double)s.mSumXX / n - x * x ), 
+									(float)( (double)s.mSumXY / n - x * y ), 
+									(float)( (double)s.mSumYY / n - y * y ) );
+		blob.mId			= -1;
+		blob.mIntensity		= (float)( (double)s.mSumI / n );
+		blob.mMax			= vec2( (float)s.mMaxX + 1.0f, (float)s.mMaxY + 1.0f );
+		blob.mMin			= vec2( (float)s.mMinX, (float)s.mMinY );
+		mDetected.push_back( blob );
+	}
+}
+
+struct BlobMatch
+{
+	bool operator<( const BlobMatch& rhs ) const
+	{
+		return mDistance < rhs.mDistance;
+	}
+
+	float	mDistance;
+	size_t	mDetected;
+	size_t	mPrevious;
+};
+
+void BlobTracker::track( int32_t camera )
+{
+	// Only this thread writes mBlobs, so it can be read without locking
+	vector<size_t> previous;
+	for ( size_t i = 0; i < mBlobs.size(); ++i ) {
+		if ( mBlobs[ i ].mCamera == camera ) {
+			previous.push_back( i );
+		}
+	}
+
+	// Closest pairs first
+	vector<BlobMatch> matches;
+	float maxDistance = mOptions.mMaxDistance * mOptions.mMaxDistance;
+	for ( size_t i = 0; i < mDetected.size(); ++i ) {
+		for ( size_t j = 0; j < previous.size(); ++j ) {
+			vec2 d		= mDetected[ i ].mCentroid - mBlobs[ previous[ j ] ].mCentroid;
+			float dist	= d.x * d.x + d.y * d.y;
+			if ( dist <= maxDistance ) {
+				BlobMatch match = { dist, i, j };
+				matches.push_back( match );
+			}
+		}
+	}
+	sort( matches.begin(), matches.end() );
+
+	vector<bool> taken( previous.size(), false );
+	for ( vector<BlobMatch>::const_iterator iter = matches.begin(); iter != matches.end(); ++iter ) {
+		Blob& blob = mDetected[ iter->mDetected ];
+		if ( blob.mId >= 0 || taken[ iter->mPrevious ] ) {
+			continue;
+		}
+		const Blob& prev		= mBlobs[ previous[ iter->mPrevious ] ];
+		blob.mAge				= prev.mAge + 1;
+		blob.mId				= prev.mId;
+		taken[ iter->mPrevious ]	= true;
+	}
+	for ( vector<Blob>::iterator iter = mDetected.begin(); iter != mDetected.end(); ++iter ) {
+		if ( iter->mId < 0 ) {
+			iter->mId = mNextId++;
+		}
+	}
+
+	lock_guard<mutex> lock( mMutex );
+	mBlobs.erase( remove_if( mBlobs.begin(), mBlobs.end(), [ camera ]( const Blob& blob )
+	{
+		return blob.mCamera == camera;
+	} ), mBlobs.end() );
+	mBlobs.insert( mBlobs.end(), mDetected.begin(), mDetected.end() );
+}
+
+}
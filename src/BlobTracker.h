@@ -0,0 +1,157 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace LeapMotion {
+
+typedef std::shared_ptr<class BlobTracker> BlobTrackerRef;
+
+/*! Finds and tracks bright blobs (eg, retro-reflective markers) in 
+	raw IR camera images. Pixels are thresholded 16 at a time with SSE2 
+	where available, and components are labelled in one pass over 
+	pixel runs with union-find, accumulating moments as they go. Blobs 
+	keep their id from frame to frame while they move less than 
+	maxDistance pixels. */
+class BlobTracker
+{
+public:
+	struct Blob
+	{
+		//! Frames this blob has been tracked.
+		uint32_t		mAge;
+		float			mArea;
+		//! Camera (image id) the blob was found in.
+		int32_t			mCamera;
+		//! Center in pixels.
+		ci::vec2		mCentroid;
+		//! Central second moments (xx, xy, yy) in square pixels.
+		ci::vec3		mCovariance;
+		int32_t			mId;
+		//! Mean pixel value.
+		float			mIntensity;
+		ci::vec2		mMax;
+		ci::vec2		mMin;
+	};
+
+	struct Options
+	{
+		Options();
+
+		//! Pixels at or above this value are foreground.
+		Options&		threshold( uint8_t v ) { mThreshold = v; return *this; }
+		//! Smallest blob in pixels.
+		Options&		minArea( uint32_t v ) { mMinArea = v; return *this; }
+		//! Largest blob in pixels. Zero is unlimited.
+		Options&		maxArea( uint32_t v ) { mMaxArea = v; return *this; }
+		//! Furthest a blob may move between frames and keep its id.
+		Options&		maxDistance( float v ) { mMaxDistance = v; return *this; }
+
+		uint32_t		mMaxArea;
+		float			mMaxDistance;
+		uint32_t		mMinArea;
+		uint8_t			mThreshold;
+	};
+
+	//! Creates tracker fed manually with update().
+	static BlobTrackerRef	create( const Options& options = Options() );
+	/*! Creates tracker fed by \a device on a worker thread. Holds the 
+		images policy while alive. Stale frames are skipped if detection 
+		falls behind. */
+	static BlobTrackerRef	create( const DeviceRef& device, const Options& options = Options() );
+	~BlobTracker();
+
+	//! Detects blobs in every image in \a frame.
+	void					update( const Leap::Frame& frame );
+	//! Detects blobs in \a image, replacing previous results for its camera.
+	void					update( const Leap::Image& image );
+	//! Detects blobs in an 8-bit image, replacing previous results for \a camera.
+	void					update( const uint8_t* data, int32_t width, int32_t height, int32_t camera );
+
+	//! Returns blobs from the latest images. Thread-safe.
+	std::vector<Blob>		getBlobs() const;
+	//! Returns blobs from the latest image from \a camera. Thread-safe.
+	std::vector<Blob>		getBlobs( int32_t camera ) const;
+	const Options&			getOptions() const;
+protected:
+	struct Run
+	{
+		int32_t			mEnd;
+		int32_t			mLabel;
+		int32_t			mStart;
+	};
+
+	struct Stats
+	{
+		int64_t			mCount;
+		int32_t			mMaxX;
+		int32_t			mMaxY;
+		int32_t			mMinX;
+		int32_t			mMinY;
+		int64_t			mSumI;
+		int64_t			mSumX;
+		int64_t			mSumXX;
+		int64_t			mSumXY;
+		int64_t			mSumY;
+		int64_t			mSumYY;
+	};
+
+	BlobTracker( const Options& options );
+
+	void					detect( const uint8_t* data, int32_t width, int32_t height, int32_t camera );
+	int32_t					find( int32_t label );
+	void					track( int32_t camera );
+
+	std::vector<Blob>		mBlobs;
+	std::vector<Blob>		mDetected;
+	std::vector<Run>		mRuns;
+	std::vector<Run>		mRunsPrev;
+	std::vector<int32_t>	mParents;
+	std::vector<Stats>		mStats;
+
+	PolicySubscriptionRef	mImages;
+	mutable std::mutex		mMutex;
+	int32_t					mNextId;
+	Options					mOptions;
+	FrameSubscriptionRef	mSubscription;
+};
+
+}
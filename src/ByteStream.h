@@ -0,0 +1,139 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Little-endian varint helpers shared by the binary formats (FrameCodec, 
+// ImageRecorder). Internal to the block.
+
+namespace LeapMotion {
+
+inline void writeVarint( std::vector<uint8_t>& buffer, uint64_t v )
+{
+	while ( v >= 0x80 ) {
+		buffer.push_back( (uint8_t)( v | 0x80 ) );
+		v >>= 7;
+	}
+	buffer.push_back( (uint8_t)v );
+}
+
+//! Zig-zag encodes \a v so small magnitudes of either sign stay short.
+inline void writeSigned( std::vector<uint8_t>& buffer, int64_t v )
+{
+	writeVarint( buffer, ( (uint64_t)v << 1 ) ^ (uint64_t)( v >> 63 ) );
+}
+
+inline void writeFloat( std::vector<uint8_t>& buffer, float v )
+{
+	uint8_t bytes[ 4 ];
+	memcpy( bytes, &v, 4 );
+	buffer.insert( buffer.end(), bytes, bytes + 4 );
+}
+
+//! Bounds-checked reader. Any overrun sets the error flag.
+class ByteReader
+{
+public:
+	ByteReader( const uint8_t* data, size_t size )
+	: mData( data ), mEnd( data + size ), mError( false ), mPosition( data )
+	{
+	}
+
+	uint8_t readByte()
+	{
+		if ( mPosition >= mEnd ) {
+			mError = true;
+			return 0;
+		}
+		return *mPosition++;
+	}
+
+	//! Returns \a size bytes in place, or null if there are fewer left.
+	const uint8_t* readBytes( size_t size )
+	{
+		if ( (size_t)( mEnd - mPosition ) < size ) {
+			mError = true;
+			return nullptr;
+		}
+		const uint8_t* data = mPosition;
+		mPosition += size;
+		return data;
+	}
+
+	float readFloat()
+	{
+		const uint8_t* data = readBytes( 4 );
+		float v = 0.0f;
+		if ( data != nullptr ) {
+			memcpy( &v, data, 4 );
+		}
+		return v;
+	}
+
+	int64_t readSigned()
+	{
+		uint64_t v = readVarint();
+		return (int64_t)( v >> 1 ) ^ -(int64_t)( v & 1 );
+	}
+
+	uint64_t readVarint()
+	{
+		uint64_t v = 0;
+		for ( uint32_t shift = 0; shift < 64; shift += 7 ) {
+			uint8_t b = readByte();
+			v |= (uint64_t)( b & 0x7F ) << shift;
+			if ( ( b & 0x80 ) == 0 || mError ) {
+				return v;
+			}
+		}
+		mError = true;
+		return v;
+	}
+
+	bool		hasError() const	{ return mError; }
+	size_t		getOffset() const	{ return (size_t)( mPosition - mData ); }
+private:
+	const uint8_t*	mData;
+	const uint8_t*	mEnd;
+	bool			mError;
+	const uint8_t*	mPosition;
+};
+
+}
@@ -35,9 +35,14 @@
 */
 
 #include "Cinder-LeapMotion.h"
+#include "Simd.h"
 
 #include "cinder/app/App.h"
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -111,21 +116,895 @@ Leap::Vector toLeapVector( const vec3& v )
 	return Leap::Vector( v.x, v.y, v.z );
 }
 
+void transformPoints( const mat4& m, const vec3* positions, size_t count, vec3* result )
+{
+	size_t i = 0;
+#if defined( LEAPMOTION_SSE )
+	__m128 c0 = _mm_setr_ps( m[ 0 ][ 0 ], m[ 0 ][ 1 ], m[ 0 ][ 2 ], 0.0f );
+	__m128 c1 = _mm_setr_ps( m[ 1 ][ 0 ], m[ 1 ][ 1 ], m[ 1 ][ 2 ], 0.0f );
+	__m128 c2 = _mm_setr_ps( m[ 2 ][ 0 ], m[ 2 ][ 1 ], m[ 2 ][ 2 ], 0.0f );
+	__m128 c3 = _mm_setr_ps( m[ 3 ][ 0 ], m[ 3 ][ 1 ], m[ 3 ][ 2 ], 0.0f );
+	float v[ 4 ];
+	for ( ; i < count; ++i ) {
+		const float* p	= &positions[ i ].x;
+		__m128 r		= _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( p[ 0 ] ) ), c3 );
+		r				= _mm_add_ps( _mm_mul_ps( c1, _mm_set1_ps( p[ 1 ] ) ), r );
+		r				= _mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps( p[ 2 ] ) ), r );
+		_mm_storeu_ps( v, r );
+		result[ i ]		= vec3( v[ 0 ], v[ 1 ], v[ 2 ] );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		const vec3& p	= positions[ i ];
+		result[ i ]		= vec3( m[ 0 ] ) * p.x + vec3( m[ 1 ] ) * p.y + vec3( m[ 2 ] ) * p.z + vec3( m[ 3 ] );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Applies r = p * scale + offset (optionally clamped to 0-1) to 
+	\a count packed vec3s. SSE path works on four points (12 floats) 
+	at a time using three rotated copies of the per-axis constants. */
+static void scaleOffset( const vec3& scale, const vec3& offset, const vec3* positions, 
+						 size_t count, vec3* result, bool clamp )
+{
+	const float* src	= &positions[ 0 ].x;
+	float* dst			= &result[ 0 ].x;
+	size_t n			= count * 3;
+	size_t i			= 0;
+#if defined( LEAPMOTION_SSE )
+	__m128 s0	= _mm_setr_ps( scale.x, scale.y, scale.z, scale.x );
+	__m128 s1	= _mm_setr_ps( scale.y, scale.z, scale.x, scale.y );
+	__m128 s2	= _mm_setr_ps( scale.z, scale.x, scale.y, scale.z );
+	__m128 o0	= _mm_setr_ps( offset.x, offset.y, offset.z, offset.x );
+	__m128 o1	= _mm_setr_ps( offset.y, offset.z, offset.x, offset.y );
+	__m128 o2	= _mm_setr_ps( offset.z, offset.x, offset.y, offset.z );
+	__m128 lo	= _mm_setzero_ps();
+	__m128 hi	= _mm_set1_ps( 1.0f );
+	for ( ; i + 12 <= n; i += 12 ) {
+		__m128 a = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( src + i + 0 ), s0 ), o0 );
+		__m128 b = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( src + i + 4 ), s1 ), o1 );
+		__m128 c = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( src + i + 8 ), s2 ), o2 );
+		if ( clamp ) {
+			a = _mm_min_ps( _mm_max_ps( a, lo ), hi );
+			b = _mm_min_ps( _mm_max_ps( b, lo ), hi );
+			c = _mm_min_ps( _mm_max_ps( c, lo ), hi );
+		}
+		_mm_storeu_ps( dst + i + 0, a );
+		_mm_storeu_ps( dst + i + 4, b );
+		_mm_storeu_ps( dst + i + 8, c );
+	}
+#endif
+	for ( ; i < n; ++i ) {
+		size_t axis	= i % 3;
+		float v		= src[ i ] * scale[ axis ] + offset[ axis ];
+		dst[ i ]	= clamp ? glm::clamp( v, 0.0f, 1.0f ) : v;
+	}
+}
+
+InteractionBoxTransform::InteractionBoxTransform()
+: mCenter( 0.0f ), mSize( 1.0f ), mValid( false )
+{
+}
+
+InteractionBoxTransform::InteractionBoxTransform( const Leap::InteractionBox& box )
+: mCenter( 0.0f ), mSize( 1.0f ), mValid( box.isValid() )
+{
+	if ( mValid ) {
+		mCenter	= toVec3( box.center() );
+		mSize	= vec3( box.width(), box.height(), box.depth() );
+		mValid	= mSize.x > 0.0f && mSize.y > 0.0f && mSize.z > 0.0f;
+	}
+}
+
+const vec3& InteractionBoxTransform::getCenter() const
+{
+	return mCenter;
+}
+
+const vec3& InteractionBoxTransform::getSize() const
+{
+	return mSize;
+}
+
+bool InteractionBoxTransform::isValid() const
+{
+	return mValid;
+}
+
+mat4 InteractionBoxTransform::getNormalizeMatrix() const
+{
+	vec3 scale( 1.0f / mSize );
+	mat4 m( 1.0f );
+	m[ 0 ][ 0 ] = scale.x;
+	m[ 1 ][ 1 ] = scale.y;
+	m[ 2 ][ 2 ] = scale.z;
+	m[ 3 ]		= vec4( vec3( 0.5f ) - mCenter * scale, 1.0f );
+	return m;
+}
+
+mat4 InteractionBoxTransform::getDenormalizeMatrix() const
+{
+	mat4 m( 1.0f );
+	m[ 0 ][ 0 ] = mSize.x;
+	m[ 1 ][ 1 ] = mSize.y;
+	m[ 2 ][ 2 ] = mSize.z;
+	m[ 3 ]		= vec4( mCenter - mSize * 0.5f, 1.0f );
+	return m;
+}
+
+vec3 InteractionBoxTransform::normalize( const vec3& position, bool clamp ) const
+{
+	vec3 v = ( position - mCenter ) / mSize + vec3( 0.5f );
+	return clamp ? glm::clamp( v, 0.0f, 1.0f ) : v;
+}
+
+void InteractionBoxTransform::normalize( const vec3* positions, size_t count, vec3* result, bool clamp ) const
+{
+	if ( count > 0 ) {
+		vec3 scale( 1.0f / mSize );
+		scaleOffset( scale, vec3( 0.5f ) - mCenter * scale, positions, count, result, clamp );
+	}
+}
+
+vec3 InteractionBoxTransform::denormalize( const vec3& position ) const
+{
+	return ( position - vec3( 0.5f ) ) * mSize + mCenter;
+}
+
+void InteractionBoxTransform::denormalize( const vec3* positions, size_t count, vec3* result ) const
+{
+	if ( count > 0 ) {
+		scaleOffset( mSize, mCenter - mSize * 0.5f, positions, count, result, false );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined( LEAPMOTION_SSE )
+// Writes x, y and z of \a v to three four-lane registers
+static inline void broadcast( const vec3& v, __m128* lanes )
+{
+	lanes[ 0 ] = _mm_set1_ps( v.x );
+	lanes[ 1 ] = _mm_set1_ps( v.y );
+	lanes[ 2 ] = _mm_set1_ps( v.z );
+}
+
+// Returns lanes of \a a where \a mask is set, \a b elsewhere
+static inline __m128 select( const __m128& mask, const __m128& a, const __m128& b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+#endif
+
+ScreenCalibration::ScreenCalibration()
+: mValid( false )
+{
+}
+
+ScreenCalibration::ScreenCalibration( const Leap::ScreenList& screens )
+: mValid( true )
+{
+	for ( Leap::ScreenList::const_iterator iter = screens.begin(); iter != screens.end(); ++iter ) {
+		const Leap::Screen& s = *iter;
+		if ( !s.isValid() ) {
+			continue;
+		}
+
+		Screen screen;
+		screen.mAxisX		= toVec3( s.horizontalAxis() );
+		screen.mAxisY		= toVec3( s.verticalAxis() );
+		screen.mNormal		= toVec3( s.normal() );
+		screen.mOrigin		= toVec3( s.bottomLeftCorner() );
+
+		float x				= glm::dot( screen.mAxisX, screen.mAxisX );
+		float y				= glm::dot( screen.mAxisY, screen.mAxisY );
+		screen.mInvAxisX	= x > 0.0f ? screen.mAxisX / x : vec3( 0.0f );
+		screen.mInvAxisY	= y > 0.0f ? screen.mAxisY / y : vec3( 0.0f );
+		mScreens.push_back( screen );
+	}
+}
+
+size_t ScreenCalibration::getNumScreens() const
+{
+	return mScreens.size();
+}
+
+void ScreenCalibration::invalidate()
+{
+	mValid = false;
+}
+
+bool ScreenCalibration::isValid() const
+{
+	return mValid;
+}
+
+vec3 ScreenCalibration::toScreen( const Screen& screen, const vec3& v, bool normalize, float clampRatio ) const
+{
+	vec3 d		= v - screen.mOrigin;
+	float u		= glm::dot( d, screen.mInvAxisX );
+	float w		= glm::dot( d, screen.mInvAxisY );
+	float r		= clampRatio * 0.5f;
+	u			= glm::clamp( u, 0.5f - r, 0.5f + r );
+	w			= glm::clamp( w, 0.5f - r, 0.5f + r );
+	if ( normalize ) {
+		return vec3( u, w, 0.0f );
+	}
+	return screen.mOrigin + screen.mAxisX * u + screen.mAxisY * w;
+}
+
+void ScreenCalibration::project( const vec3* positions, size_t count, vec3* result, 
+								 bool normalize, float clampRatio ) const
+{
+	if ( mScreens.empty() ) {
+		fill( result, result + count, vec3( 0.0f ) );
+		return;
+	}
+
+	const Screen* first = &mScreens[ 0 ];
+	const Screen* last	= first + mScreens.size();
+	size_t i			= 0;
+#if defined( LEAPMOTION_SSE )
+	// Four points at a time, split into x, y and z lanes. Each lane 
+	// selects its closest screen's constants with a compare mask, so 
+	// points nearest different screens need no branches. Constants are 
+	// origin, inverse x and y axes, then x and y axes.
+	auto load = []( const Screen& screen, __m128* c )
+	{
+		broadcast( screen.mOrigin,		c );
+		broadcast( screen.mInvAxisX,	c + 3 );
+		broadcast( screen.mInvAxisY,	c + 6 );
+		broadcast( screen.mAxisX,		c + 9 );
+		broadcast( screen.mAxisY,		c + 12 );
+	};
+	__m128 base[ 15 ];
+	load( *first, base );
+	__m128 r	= _mm_set1_ps( clampRatio * 0.5f );
+	__m128 lo	= _mm_sub_ps( _mm_set1_ps( 0.5f ), r );
+	__m128 hi	= _mm_add_ps( _mm_set1_ps( 0.5f ), r );
+	__m128 sign	= _mm_set1_ps( -0.0f );
+	float x[ 4 ];
+	float y[ 4 ];
+	float z[ 4 ];
+	for ( ; i + 4 <= count; i += 4 ) {
+		const vec3* p	= positions + i;
+		__m128 px		= _mm_setr_ps( p[ 0 ].x, p[ 1 ].x, p[ 2 ].x, p[ 3 ].x );
+		__m128 py		= _mm_setr_ps( p[ 0 ].y, p[ 1 ].y, p[ 2 ].y, p[ 3 ].y );
+		__m128 pz		= _mm_setr_ps( p[ 0 ].z, p[ 1 ].z, p[ 2 ].z, p[ 3 ].z );
+
+		__m128 c[ 15 ];
+		copy( base, base + 15, c );
+		if ( last - first > 1 ) {
+			__m128 distance = _mm_setzero_ps();
+			for ( const Screen* screen = first; screen != last; ++screen ) {
+				__m128 d = _mm_add_ps( _mm_add_ps( 
+					_mm_mul_ps( _mm_sub_ps( px, _mm_set1_ps( screen->mOrigin.x ) ), _mm_set1_ps( screen->mNormal.x ) ), 
+					_mm_mul_ps( _mm_sub_ps( py, _mm_set1_ps( screen->mOrigin.y ) ), _mm_set1_ps( screen->mNormal.y ) ) ), 
+					_mm_mul_ps( _mm_sub_ps( pz, _mm_set1_ps( screen->mOrigin.z ) ), _mm_set1_ps( screen->mNormal.z ) ) );
+				d = _mm_andnot_ps( sign, d );
+				if ( screen == first ) {
+					distance = d;
+					continue;
+				}
+				__m128 mask = _mm_cmplt_ps( d, distance );
+				if ( _mm_movemask_ps( mask ) == 0 ) {
+					continue;
+				}
+				distance = select( mask, d, distance );
+				__m128 s[ 15 ];
+				load( *screen, s );
+				for ( size_t j = 0; j < 15; ++j ) {
+					c[ j ] = select( mask, s[ j ], c[ j ] );
+				}
+			}
+		}
+
+		__m128 dx	= _mm_sub_ps( px, c[ 0 ] );
+		__m128 dy	= _mm_sub_ps( py, c[ 1 ] );
+		__m128 dz	= _mm_sub_ps( pz, c[ 2 ] );
+		__m128 u	= _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, c[ 3 ] ), _mm_mul_ps( dy, c[ 4 ] ) ), _mm_mul_ps( dz, c[ 5 ] ) );
+		__m128 w	= _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, c[ 6 ] ), _mm_mul_ps( dy, c[ 7 ] ) ), _mm_mul_ps( dz, c[ 8 ] ) );
+		u			= _mm_min_ps( _mm_max_ps( u, lo ), hi );
+		w			= _mm_min_ps( _mm_max_ps( w, lo ), hi );
+		if ( normalize ) {
+			_mm_storeu_ps( x, u );
+			_mm_storeu_ps( y, w );
+			_mm_storeu_ps( z, _mm_setzero_ps() );
+		} else {
+			_mm_storeu_ps( x, _mm_add_ps( _mm_add_ps( c[ 0 ], _mm_mul_ps( c[ 9 ], u ) ), _mm_mul_ps( c[ 12 ], w ) ) );
+			_mm_storeu_ps( y, _mm_add_ps( _mm_add_ps( c[ 1 ], _mm_mul_ps( c[ 10 ], u ) ), _mm_mul_ps( c[ 13 ], w ) ) );
+			_mm_storeu_ps( z, _mm_add_ps( _mm_add_ps( c[ 2 ], _mm_mul_ps( c[ 11 ], u ) ), _mm_mul_ps( c[ 14 ], w ) ) );
+		}
+		for ( size_t j = 0; j < 4; ++j ) {
+			result[ i + j ] = vec3( x[ j ], y[ j ], z[ j ] );
+		}
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		const vec3& p			= positions[ i ];
+		const Screen* closest	= first;
+		if ( last - first > 1 ) {
+			float distance		= numeric_limits<float>::max();
+			for ( const Screen* screen = first; screen != last; ++screen ) {
+				float d = math<float>::abs( glm::dot( p - screen->mOrigin, screen->mNormal ) );
+				if ( d < distance ) {
+					closest		= screen;
+					distance	= d;
+				}
+			}
+		}
+		result[ i ] = toScreen( *closest, p, normalize, clampRatio );
+	}
+}
+
+void ScreenCalibration::intersect( const vec3* positions, const vec3* directions, size_t count, 
+								   vec3* result, bool normalize, float clampRatio ) const
+{
+	const Screen* first = mScreens.empty() ? nullptr : &mScreens[ 0 ];
+	const Screen* last	= first + mScreens.size();
+	for ( size_t i = 0; i < count; ++i ) {
+		const vec3& p			= positions[ i ];
+		const vec3& d			= directions[ i ];
+		const Screen* closest	= nullptr;
+		float distance			= numeric_limits<float>::max();
+		vec3 hit;
+		for ( const Screen* screen = first; screen != last; ++screen ) {
+			float denom = glm::dot( d, screen->mNormal );
+			if ( denom == 0.0f ) {
+				continue;
+			}
+			float t = glm::dot( screen->mOrigin - p, screen->mNormal ) / denom;
+			if ( t >= 0.0f && t < distance ) {
+				closest		= screen;
+				distance	= t;
+				hit			= p + d * t;
+			}
+		}
+		result[ i ] = closest == nullptr ? vec3( 0.0f ) : toScreen( *closest, hit, normalize, clampRatio );
+	}
+}
+
+vector<vec3> ScreenCalibration::intersect( const Leap::PointableList& pointables, 
+										   bool normalize, float clampRatio ) const
+{
+	size_t count = (size_t)pointables.count();
+	vector<vec3> positions( count );
+	vector<vec3> directions( count );
+	vector<vec3> result( count );
+	size_t i = 0;
+	for ( Leap::PointableList::const_iterator iter = pointables.begin(); iter != pointables.end(); ++iter, ++i ) {
+		const Leap::Pointable& pointable = *iter;
+		positions[ i ]	= toVec3( pointable.tipPosition() );
+		directions[ i ]	= toVec3( pointable.direction() );
+	}
+	if ( count > 0 ) {
+		intersect( &positions[ 0 ], &directions[ 0 ], count, &result[ 0 ], normalize, clampRatio );
+	}
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameSnapshot::capture( const Leap::Frame& frame, uint32_t fields )
+{
+	static const uint32_t kHandFields	= FIELD_PALMS | FIELD_TIPS | FIELD_BONES | FIELD_ARMS;
+	static const uint32_t kFingerFields	= FIELD_TIPS | FIELD_BONES;
+
+	mFields				= fields & ~(uint32_t)FIELD_IMAGES;
+	mFramesPerSecond	= frame.currentFramesPerSecond();
+	mId					= frame.id();
+	mNumGestures		= 0;
+	mNumHands			= 0;
+	mTimestamp			= frame.timestamp();
+	if ( ( fields & FIELD_INTERACTION_BOX ) != 0 ) {
+		const Leap::InteractionBox& box = frame.interactionBox();
+		mBoxCenter		= toVec3( box.center() );
+		mBoxSize		= vec3( box.width(), box.height(), box.depth() );
+	} else {
+		mBoxCenter		= vec3( 0.0f );
+		mBoxSize		= vec3( 0.0f );
+	}
+
+	const Leap::HandList& hands = ( fields & kHandFields ) != 0 ? frame.hands() : Leap::HandList();
+	for ( Leap::HandList::const_iterator handIter = hands.begin(); 
+		  handIter != hands.end() && mNumHands < kMaxHands; ++handIter ) {
+		const Leap::Hand& hand	= *handIter;
+		HandSnapshot& h			= mHands[ mNumHands++ ];
+		h						= HandSnapshot();
+
+		h.mConfidence				= hand.confidence();
+		h.mId						= hand.id();
+		h.mLeft						= hand.isLeft();
+		h.mTimeVisible				= hand.timeVisible();
+		if ( ( fields & FIELD_PALMS ) != 0 ) {
+			h.mBasis					= toMat3( hand.basis() );
+			h.mDirection				= toVec3( hand.direction() );
+			h.mGrabStrength				= hand.grabStrength();
+			h.mPalmNormal				= toVec3( hand.palmNormal() );
+			h.mPalmPosition				= toVec3( hand.palmPosition() );
+			h.mPalmVelocity				= toVec3( hand.palmVelocity() );
+			h.mPalmWidth				= hand.palmWidth();
+			h.mPinchStrength			= hand.pinchStrength();
+			h.mStabilizedPalmPosition	= toVec3( hand.stabilizedPalmPosition() );
+		}
+		if ( ( fields & FIELD_ARMS ) != 0 ) {
+			const Leap::Arm& arm		= hand.arm();
+			h.mArmBasis					= toMat3( arm.basis() );
+			h.mArmWidth					= arm.width();
+			h.mElbowPosition			= toVec3( arm.elbowPosition() );
+			h.mWristPosition			= toVec3( arm.wristPosition() );
+		}
+		if ( ( fields & kFingerFields ) == 0 ) {
+			continue;
+		}
+
+		// Fingers are stored by type, so slot i is always the same finger
+		const Leap::FingerList& fingers = hand.fingers();
+		for ( Leap::FingerList::const_iterator fingerIter = fingers.begin(); fingerIter != fingers.end(); ++fingerIter ) {
+			const Leap::Finger& finger = *fingerIter;
+			int32_t type = (int32_t)finger.type();
+			if ( type < 0 || type > 4 ) {
+				continue;
+			}
+			FingerSnapshot& f	= h.mFingers[ type ];
+			f.mId				= finger.id();
+			f.mType				= type;
+			if ( ( fields & FIELD_TIPS ) != 0 ) {
+				f.mDirection	= toVec3( finger.direction() );
+				f.mExtended		= finger.isExtended();
+				f.mLength		= finger.length();
+				f.mTipPosition	= toVec3( finger.tipPosition() );
+				f.mTipVelocity	= toVec3( finger.tipVelocity() );
+				f.mWidth		= finger.width();
+			}
+			if ( ( fields & FIELD_BONES ) != 0 ) {
+				for ( int32_t i = 0; i < 4; ++i ) {
+					const Leap::Bone& bone	= finger.bone( (Leap::Bone::Type)i );
+					BoneSnapshot& b			= f.mBones[ i ];
+					b.mBasis				= toMat3( bone.basis() );
+					b.mNextJoint			= toVec3( bone.nextJoint() );
+					b.mPrevJoint			= toVec3( bone.prevJoint() );
+					b.mWidth				= bone.width();
+				}
+			}
+		}
+	}
+
+	if ( ( fields & FIELD_GESTURES ) == 0 ) {
+		return;
+	}
+	const Leap::GestureList& gestures = frame.gestures();
+	for ( Leap::GestureList::const_iterator gestureIter = gestures.begin(); 
+		  gestureIter != gestures.end() && mNumGestures < kMaxGestures; ++gestureIter ) {
+		const Leap::Gesture& gesture	= *gestureIter;
+		GestureSnapshot& g				= mGestures[ mNumGestures++ ];
+		const Leap::HandList& hands		= gesture.hands();
+		const Leap::PointableList& pointables = gesture.pointables();
+
+		g.mDirection	= vec3( 0.0f );
+		g.mDuration		= gesture.duration();
+		g.mHandId		= hands.isEmpty() ? -1 : hands[ 0 ].id();
+		g.mId			= gesture.id();
+		g.mPointableId	= pointables.isEmpty() ? -1 : pointables[ 0 ].id();
+		g.mPosition		= vec3( 0.0f );
+		g.mProgress		= 0.0f;
+		g.mRadius		= 0.0f;
+		g.mState		= (int32_t)gesture.state();
+		g.mType			= (int32_t)gesture.type();
+		switch ( gesture.type() ) {
+		case Leap::Gesture::TYPE_CIRCLE:
+			{
+				const Leap::CircleGesture circle( gesture );
+				g.mDirection	= toVec3( circle.normal() );
+				g.mPosition		= toVec3( circle.center() );
+				g.mProgress		= circle.progress();
+				g.mRadius		= circle.radius();
+			}
+			break;
+		case Leap::Gesture::TYPE_KEY_TAP:
+			{
+				const Leap::KeyTapGesture tap( gesture );
+				g.mDirection	= toVec3( tap.direction() );
+				g.mPosition		= toVec3( tap.position() );
+				g.mProgress		= tap.progress();
+			}
+			break;
+		case Leap::Gesture::TYPE_SCREEN_TAP:
+			{
+				const Leap::ScreenTapGesture tap( gesture );
+				g.mDirection	= toVec3( tap.direction() );
+				g.mPosition		= toVec3( tap.position() );
+				g.mProgress		= tap.progress();
+			}
+			break;
+		case Leap::Gesture::TYPE_SWIPE:
+			{
+				const Leap::SwipeGesture swipe( gesture );
+				g.mDirection	= toVec3( swipe.direction() );
+				g.mPosition		= toVec3( swipe.position() );
+				g.mProgress		= swipe.speed();
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Snapshot bases are stored transposed. Left hand bases are reflections, 
+// so z is flipped around the slerp to keep them rotations.
+static mat3 slerpBasis( const mat3& a, const mat3& b, float t, bool left )
+{
+	mat3 x = a;
+	mat3 y = b;
+	if ( left ) {
+		for ( int32_t i = 0; i < 3; ++i ) {
+			x[ i ][ 2 ] = -x[ i ][ 2 ];
+			y[ i ][ 2 ] = -y[ i ][ 2 ];
+		}
+	}
+	mat3 result = glm::mat3_cast( glm::slerp( glm::quat_cast( x ), glm::quat_cast( y ), t ) );
+	if ( left ) {
+		for ( int32_t i = 0; i < 3; ++i ) {
+			result[ i ][ 2 ] = -result[ i ][ 2 ];
+		}
+	}
+	return result;
+}
+
+static vec3 lerpDirection( const vec3& a, const vec3& b, float t )
+{
+	vec3 v			= glm::mix( a, b, t );
+	float length	= glm::length( v );
+	return length > 0.0f ? v / length : b;
+}
+
+void interpolate( const FrameSnapshot& a, const FrameSnapshot& b, float t, FrameSnapshot& result )
+{
+	result = b;
+	uint32_t fields			= a.mFields & b.mFields;
+	result.mTimestamp		= a.mTimestamp + (int64_t)( (double)( b.mTimestamp - a.mTimestamp ) * t );
+	if ( ( fields & FIELD_INTERACTION_BOX ) != 0 ) {
+		result.mBoxCenter	= glm::mix( a.mBoxCenter, b.mBoxCenter, t );
+		result.mBoxSize		= glm::mix( a.mBoxSize, b.mBoxSize, t );
+	}
+
+	for ( uint32_t i = 0; i < result.mNumHands; ++i ) {
+		HandSnapshot& h			= result.mHands[ i ];
+		const HandSnapshot* p	= nullptr;
+		for ( uint32_t j = 0; j < a.mNumHands; ++j ) {
+			if ( a.mHands[ j ].mId == h.mId && a.mHands[ j ].mLeft == h.mLeft ) {
+				p = &a.mHands[ j ];
+			}
+		}
+		if ( p == nullptr ) {
+			continue;
+		}
+
+		h.mConfidence	= glm::mix( p->mConfidence, h.mConfidence, t );
+		h.mTimeVisible	= glm::mix( p->mTimeVisible, h.mTimeVisible, t );
+		if ( ( fields & FIELD_PALMS ) != 0 ) {
+			h.mBasis					= slerpBasis( p->mBasis, h.mBasis, t, h.mLeft );
+			h.mDirection				= lerpDirection( p->mDirection, h.mDirection, t );
+			h.mGrabStrength				= glm::mix( p->mGrabStrength, h.mGrabStrength, t );
+			h.mPalmNormal				= lerpDirection( p->mPalmNormal, h.mPalmNormal, t );
+			h.mPalmPosition				= glm::mix( p->mPalmPosition, h.mPalmPosition, t );
+			h.mPalmVelocity				= glm::mix( p->mPalmVelocity, h.mPalmVelocity, t );
+			h.mPalmWidth				= glm::mix( p->mPalmWidth, h.mPalmWidth, t );
+			h.mPinchStrength			= glm::mix( p->mPinchStrength, h.mPinchStrength, t );
+			h.mStabilizedPalmPosition	= glm::mix( p->mStabilizedPalmPosition, h.mStabilizedPalmPosition, t );
+		}
+		if ( ( fields & FIELD_ARMS ) != 0 ) {
+			h.mArmBasis			= slerpBasis( p->mArmBasis, h.mArmBasis, t, h.mLeft );
+			h.mArmWidth			= glm::mix( p->mArmWidth, h.mArmWidth, t );
+			h.mElbowPosition	= glm::mix( p->mElbowPosition, h.mElbowPosition, t );
+			h.mWristPosition	= glm::mix( p->mWristPosition, h.mWristPosition, t );
+		}
+		for ( size_t j = 0; j < 5; ++j ) {
+			FingerSnapshot& f			= h.mFingers[ j ];
+			const FingerSnapshot& g		= p->mFingers[ j ];
+			if ( ( fields & FIELD_TIPS ) != 0 ) {
+				f.mDirection	= lerpDirection( g.mDirection, f.mDirection, t );
+				f.mLength		= glm::mix( g.mLength, f.mLength, t );
+				f.mTipPosition	= glm::mix( g.mTipPosition, f.mTipPosition, t );
+				f.mTipVelocity	= glm::mix( g.mTipVelocity, f.mTipVelocity, t );
+				f.mWidth		= glm::mix( g.mWidth, f.mWidth, t );
+			}
+			if ( ( fields & FIELD_BONES ) != 0 ) {
+				for ( size_t k = 0; k < 4; ++k ) {
+					BoneSnapshot& bone			= f.mBones[ k ];
+					const BoneSnapshot& prev	= g.mBones[ k ];
+					bone.mBasis		= slerpBasis( prev.mBasis, bone.mBasis, t, h.mLeft );
+					bone.mNextJoint	= glm::mix( prev.mNextJoint, bone.mNextJoint, t );
+					bone.mPrevJoint	= glm::mix( prev.mPrevJoint, bone.mPrevJoint, t );
+					bone.mWidth		= glm::mix( prev.mWidth, bone.mWidth, t );
+				}
+			}
+		}
+	}
+}
+
+// Bases go straight into columns. No transpose, no FloatArray.
+static inline void writeHandMatrix( mat4& m, const vec3& x, const vec3& y, const vec3& z, 
+									const vec3& position, const vec3& scale )
+{
+	m[ 0 ] = vec4( x * scale.x, 0.0f );
+	m[ 1 ] = vec4( y * scale.y, 0.0f );
+	m[ 2 ] = vec4( z * scale.z, 0.0f );
+	m[ 3 ] = vec4( position, 1.0f );
+}
+
+size_t computeHandMatrices( const Leap::Frame& frame, HandMatrices* result, size_t maxHands, bool scaled )
+{
+	size_t count = 0;
+	const Leap::HandList& hands = frame.hands();
+	for ( Leap::HandList::const_iterator handIter = hands.begin(); 
+		  handIter != hands.end() && count < maxHands; ++handIter ) {
+		const Leap::Hand& hand	= *handIter;
+		HandMatrices& h			= result[ count++ ];
+		float flip				= hand.isLeft() ? -1.0f : 1.0f;
+
+		const Leap::Matrix& palm = hand.basis();
+		writeHandMatrix( h.mBones[ HandMatrices::kPalm ], toVec3( palm.xBasis ), toVec3( palm.yBasis ), 
+			toVec3( palm.zBasis ), toVec3( hand.palmPosition() ), vec3( 1.0f, 1.0f, flip ) );
+
+		const Leap::Arm& arm	= hand.arm();
+		const Leap::Matrix& a	= arm.basis();
+		vec3 scale				= scaled ? vec3( arm.width(), arm.width(), arm.elbowPosition().distanceTo( arm.wristPosition() ) ) : vec3( 1.0f );
+		scale.z					*= flip;
+		writeHandMatrix( h.mBones[ HandMatrices::kArm ], toVec3( a.xBasis ), toVec3( a.yBasis ), 
+			toVec3( a.zBasis ), toVec3( arm.center() ), scale );
+
+		const Leap::FingerList& fingers = hand.fingers();
+		for ( Leap::FingerList::const_iterator fingerIter = fingers.begin(); fingerIter != fingers.end(); ++fingerIter ) {
+			const Leap::Finger& finger	= *fingerIter;
+			int32_t type				= (int32_t)finger.type();
+			if ( type < 0 || type > 4 ) {
+				continue;
+			}
+			for ( int32_t i = 0; i < 4; ++i ) {
+				const Leap::Bone& bone	= finger.bone( (Leap::Bone::Type)i );
+				const Leap::Matrix& b	= bone.basis();
+				vec3 scale				= scaled ? vec3( bone.width(), bone.width(), bone.length() ) : vec3( 1.0f );
+				scale.z					*= flip;
+				writeHandMatrix( h.mBones[ type * 4 + i ], toVec3( b.xBasis ), toVec3( b.yBasis ), 
+					toVec3( b.zBasis ), toVec3( bone.center() ), scale );
+			}
+		}
+	}
+	return count;
+}
+
+size_t computeHandMatrices( const FrameSnapshot& frame, HandMatrices* result, size_t maxHands, bool scaled )
+{
+	// Snapshot bases are stored transposed, as by toMat3()
+	size_t count = min( (size_t)frame.mNumHands, maxHands );
+	for ( size_t i = 0; i < count; ++i ) {
+		const HandSnapshot& hand	= frame.mHands[ i ];
+		HandMatrices& h				= result[ i ];
+		float flip					= hand.mLeft ? -1.0f : 1.0f;
+
+		const mat3& palm = hand.mBasis;
+		writeHandMatrix( h.mBones[ HandMatrices::kPalm ], 
+			vec3( palm[ 0 ][ 0 ], palm[ 1 ][ 0 ], palm[ 2 ][ 0 ] ), 
+			vec3( palm[ 0 ][ 1 ], palm[ 1 ][ 1 ], palm[ 2 ][ 1 ] ), 
+			vec3( palm[ 0 ][ 2 ], palm[ 1 ][ 2 ], palm[ 2 ][ 2 ] ), 
+			hand.mPalmPosition, vec3( 1.0f, 1.0f, flip ) );
+
+		const mat3& a	= hand.mArmBasis;
+		vec3 scale		= scaled ? vec3( hand.mArmWidth, hand.mArmWidth, glm::distance( hand.mElbowPosition, hand.mWristPosition ) ) : vec3( 1.0f );
+		scale.z			*= flip;
+		writeHandMatrix( h.mBones[ HandMatrices::kArm ], 
+			vec3( a[ 0 ][ 0 ], a[ 1 ][ 0 ], a[ 2 ][ 0 ] ), 
+			vec3( a[ 0 ][ 1 ], a[ 1 ][ 1 ], a[ 2 ][ 1 ] ), 
+			vec3( a[ 0 ][ 2 ], a[ 1 ][ 2 ], a[ 2 ][ 2 ] ), 
+			( hand.mElbowPosition + hand.mWristPosition ) * 0.5f, scale );
+
+		for ( size_t j = 0; j < 20; ++j ) {
+			const BoneSnapshot& bone	= hand.mFingers[ j / 4 ].mBones[ j % 4 ];
+			const mat3& b				= bone.mBasis;
+			vec3 scale					= scaled ? vec3( bone.mWidth, bone.mWidth, glm::distance( bone.mPrevJoint, bone.mNextJoint ) ) : vec3( 1.0f );
+			scale.z						*= flip;
+			writeHandMatrix( h.mBones[ j ], 
+				vec3( b[ 0 ][ 0 ], b[ 1 ][ 0 ], b[ 2 ][ 0 ] ), 
+				vec3( b[ 0 ][ 1 ], b[ 1 ][ 1 ], b[ 2 ][ 1 ] ), 
+				vec3( b[ 0 ][ 2 ], b[ 1 ][ 2 ], b[ 2 ][ 2 ] ), 
+				( bone.mPrevJoint + bone.mNextJoint ) * 0.5f, scale );
+		}
+	}
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+HandIdentityTracker::HandIdentityTracker( float maxDistance, double maxGap )
+: mMaxDistance( maxDistance ), mMaxGap( maxGap ), mNextId( 0 )
+{
+}
+
+void HandIdentityTracker::update( const Leap::Frame& frame )
+{
+	mObserved.clear();
+	const Leap::HandList& hands = frame.hands();
+	for ( Leap::HandList::const_iterator iter = hands.begin(); iter != hands.end(); ++iter ) {
+		const Leap::Hand& hand = *iter;
+		Track track;
+		track.mActive	= false;
+		track.mId		= hand.id();
+		track.mLeft		= hand.isLeft();
+		track.mPosition	= toVec3( hand.palmPosition() );
+		track.mStableId	= -1;
+		track.mTimestamp	= 0;
+		track.mVelocity	= toVec3( hand.palmVelocity() );
+		mObserved.push_back( track );
+	}
+	update( frame.timestamp() );
+}
+
+void HandIdentityTracker::update( const FrameSnapshot& frame )
+{
+	mObserved.clear();
+	for ( uint32_t i = 0; i < frame.mNumHands; ++i ) {
+		const HandSnapshot& hand = frame.mHands[ i ];
+		Track track;
+		track.mActive	= false;
+		track.mId		= hand.mId;
+		track.mLeft		= hand.mLeft;
+		track.mPosition	= hand.mPalmPosition;
+		track.mStableId	= -1;
+		track.mTimestamp	= 0;
+		track.mVelocity	= hand.mPalmVelocity;
+		mObserved.push_back( track );
+	}
+	update( frame.mTimestamp );
+}
+
+void HandIdentityTracker::update( int64_t timestamp )
+{
+	// Continue tracks whose SDK id is still present
+	for ( vector<Track>::iterator track = mTracks.begin(); track != mTracks.end(); ++track ) {
+		bool found = false;
+		for ( vector<Track>::iterator hand = mObserved.begin(); hand != mObserved.end(); ++hand ) {
+			if ( track->mActive && hand->mStableId < 0 && hand->mId == track->mId ) {
+				hand->mStableId	= track->mStableId;
+				track->mLeft		= hand->mLeft;
+				track->mPosition	= hand->mPosition;
+				track->mTimestamp	= timestamp;
+				track->mVelocity	= hand->mVelocity;
+				found				= true;
+				break;
+			}
+		}
+		track->mActive = found;
+	}
+	
+	// Drop tracks lost for too long
+	int64_t maxGap = (int64_t)( mMaxGap * 1000000.0 );
+	for ( vector<Track>::iterator track = mTracks.begin(); track != mTracks.end(); ) {
+		if ( !track->mActive && timestamp - track->mTimestamp > maxGap ) {
+			track = mTracks.erase( track );
+		} else {
+			++track;
+		}
+	}
+
+	// Match new hands to lost tracks on the same side, closest first
+	mCandidates.clear();
+	for ( size_t i = 0; i < mObserved.size(); ++i ) {
+		const Track& hand = mObserved[ i ];
+		if ( hand.mStableId >= 0 ) {
+			continue;
+		}
+		for ( size_t j = 0; j < mTracks.size(); ++j ) {
+			const Track& track = mTracks[ j ];
+			if ( track.mActive || track.mLeft != hand.mLeft ) {
+				continue;
+			}
+			float dt		= (float)( timestamp - track.mTimestamp ) / 1000000.0f;
+			vec3 predicted	= track.mPosition + track.mVelocity * dt;
+			float distance	= glm::distance( predicted, hand.mPosition );
+			if ( distance <= mMaxDistance ) {
+				Candidate candidate;
+				candidate.mDistance	= distance;
+				candidate.mHand		= (uint32_t)i;
+				candidate.mTrack	= (uint32_t)j;
+				mCandidates.push_back( candidate );
+			}
+		}
+	}
+	sort( mCandidates.begin(), mCandidates.end(), []( const Candidate& a, const Candidate& b )
+	{
+		return a.mDistance < b.mDistance;
+	} );
+	for ( vector<Candidate>::const_iterator iter = mCandidates.begin(); iter != mCandidates.end(); ++iter ) {
+		Track& hand		= mObserved[ iter->mHand ];
+		Track& track	= mTracks[ iter->mTrack ];
+		if ( hand.mStableId >= 0 || track.mActive ) {
+			continue;
+		}
+		hand.mStableId		= track.mStableId;
+		track.mActive		= true;
+		track.mId			= hand.mId;
+		track.mPosition		= hand.mPosition;
+		track.mTimestamp	= timestamp;
+		track.mVelocity		= hand.mVelocity;
+	}
+
+	// Anything left is a new hand
+	for ( vector<Track>::iterator hand = mObserved.begin(); hand != mObserved.end(); ++hand ) {
+		if ( hand->mStableId < 0 ) {
+			hand->mActive		= true;
+			hand->mStableId		= mNextId++;
+			hand->mTimestamp	= timestamp;
+			mTracks.push_back( *hand );
+		}
+	}
+}
+
+void HandIdentityTracker::clear()
+{
+	mObserved.clear();
+	mTracks.clear();
+}
+
+int32_t HandIdentityTracker::getStableId( int32_t id ) const
+{
+	for ( vector<Track>::const_iterator iter = mTracks.begin(); iter != mTracks.end(); ++iter ) {
+		if ( iter->mActive && iter->mId == id ) {
+			return iter->mStableId;
+		}
+	}
+	return -1;
+}
+
+size_t HandIdentityTracker::getNumHands() const
+{
+	return mObserved.size();
+}
+
+float HandIdentityTracker::getMaxDistance() const
+{
+	return mMaxDistance;
+}
+
+void HandIdentityTracker::setMaxDistance( float v )
+{
+	mMaxDistance = v;
+}
+
+double HandIdentityTracker::getMaxGap() const
+{
+	return mMaxGap;
+}
+
+void HandIdentityTracker::setMaxGap( double v )
+{
+	mMaxGap = v;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 Listener::Listener()
 {
 	mConnected		= false;
+	mDevice			= nullptr;
 	mExited			= false;
 	mFocused		= false;
+	mFrameCount		= 0;
 	mInitialized	= false;
 	mNewFrame		= false;
 }
 
 void Listener::onConnect( const Leap::Controller& controller ) 
 {
-	lock_guard<mutex> lock( *mMutex );
-	mConnected = true;
+	{
+		lock_guard<mutex> lock( *mMutex );
+		mConnected = true;
+	}
+	mCondition.notify_all();
 }
 
 void Listener::onDisconnect( const Leap::Controller& controller ) 
@@ -136,8 +1015,11 @@ void Listener::onDisconnect( const Leap::Controller& controller )
 	
 void Listener::onExit( const Leap::Controller& controller )
 {
-	lock_guard<mutex> lock( *mMutex );
-	mExited = true;
+	{
+		lock_guard<mutex> lock( *mMutex );
+		mExited = true;
+	}
+	mCondition.notify_all();
 }
 
 void Listener::onFocusGained( const Leap::Controller& controller )
@@ -154,10 +1036,22 @@ void Listener::onFocusLost( const Leap::Controller& controller )
 	
 void Listener::onFrame( const Leap::Controller& controller ) 
 {
-	lock_guard<mutex> lock( *mMutex );
-	if ( !mNewFrame ) {
-		mFrame		= controller.frame();
-		mNewFrame	= true;
+	Leap::Frame frame = controller.frame();
+	if ( mDevice != nullptr && !mDevice->admit( frame ) ) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock( *mMutex );
+		mLatestFrame = frame;
+		++mFrameCount;
+		if ( !mNewFrame ) {
+			mFrame		= frame;
+			mNewFrame	= true;
+		}
+	}
+	mCondition.notify_all();
+	if ( mDevice != nullptr ) {
+		mDevice->dispatch( frame, false );
 	}
 }
 
@@ -169,30 +1063,708 @@ void Listener::onInit( const Leap::Controller& controller )
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
-DeviceRef Device::create()
+// Subscriber count per policy bit. Outlives the device if subscriptions 
+// are still held, in which case mController is null. Suspended policies 
+// stay cleared on the controller but keep counting. mHeld mirrors the 
+// non-zero counts so it can be read without taking the lock.
+struct PolicySubscription::Counter
 {
-	return DeviceRef( new Device() );
-}
+	Counter( Leap::Controller* controller )
+	: mController( controller ), mHeld( 0 ), mSuspended( 0 )
+	{
+		fill( mCounts, mCounts + 32, 0 );
+	}
 
-Device::Device()
-{
-	mListener.mMutex	= &mMutex;
-	mController			= new Leap::Controller( mListener );
+	void acquire( Leap::Controller::PolicyFlag policy )
+	{
+		lock_guard<mutex> lock( mMutex );
+		for ( uint32_t i = 0; i < 32; ++i ) {
+			uint32_t bit = 1u << i;
+			if ( ( policy & bit ) != 0 && mCounts[ i ]++ == 0 ) {
+				mHeld |= bit;
+				apply( bit, ( mSuspended & bit ) == 0 );
+			}
+		}
+	}
 
-	App::get()->getSignalUpdate().connect( bind( &Device::update, this ) );
-}
+	void release( Leap::Controller::PolicyFlag policy )
+	{
+		lock_guard<mutex> lock( mMutex );
+		for ( uint32_t i = 0; i < 32; ++i ) {
+			uint32_t bit = 1u << i;
+			if ( ( policy & bit ) != 0 && mCounts[ i ] > 0 && --mCounts[ i ] == 0 ) {
+				mHeld &= ~bit;
+				apply( bit, false );
+			}
+		}
+	}
 
-Device::~Device()
+	void suspend( uint32_t policies )
+	{
+		lock_guard<mutex> lock( mMutex );
+		uint32_t changed = mSuspended ^ policies;
+		mSuspended = policies;
+		for ( uint32_t i = 0; i < 32; ++i ) {
+			uint32_t bit = 1u << i;
+			if ( ( changed & bit ) != 0 && mCounts[ i ] > 0 ) {
+				apply( bit, ( policies & bit ) == 0 );
+			}
+		}
+	}
+
+	void apply( uint32_t bit, bool enabled )
+	{
+		if ( mController == nullptr ) {
+			return;
+		}
+		if ( enabled ) {
+			mController->setPolicy( (Leap::Controller::PolicyFlag)bit );
+		} else {
+			mController->clearPolicy( (Leap::Controller::PolicyFlag)bit );
+		}
+	}
+
+	Leap::Controller*	mController;
+	size_t				mCounts[ 32 ];
+	atomic<uint32_t>	mHeld;
+	mutex				mMutex;
+	uint32_t			mSuspended;
+};
+
+PolicySubscription::PolicySubscription( const shared_ptr<Counter>& counter, Leap::Controller::PolicyFlag policy )
+: mCounter( counter ), mPolicy( policy )
 {
-	disconnectEventHandler();
-	mController->removeListener( mListener );
+	mCounter->acquire( mPolicy );
 }
 
-Leap::Controller* Device::getController() const
+PolicySubscription::~PolicySubscription()
 {
-	return mController;
+	mCounter->release( mPolicy );
+}
+
+Leap::Controller::PolicyFlag PolicySubscription::getPolicy() const
+{
+	return mPolicy;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Subscriber count per FrameField bit. mHeld mirrors the non-zero 
+// counts so it can be read without taking the lock.
+struct FieldSubscription::Counter
+{
+	Counter()
+	: mHeld( 0 )
+	{
+		fill( mCounts, mCounts + kNumFrameFields, 0 );
+	}
+
+	void acquire( uint32_t fields )
+	{
+		lock_guard<mutex> lock( mMutex );
+		for ( size_t i = 0; i < kNumFrameFields; ++i ) {
+			uint32_t bit = 1u << i;
+			if ( ( fields & bit ) != 0 && mCounts[ i ]++ == 0 ) {
+				mHeld |= bit;
+			}
+		}
+	}
+
+	void release( uint32_t fields )
+	{
+		lock_guard<mutex> lock( mMutex );
+		for ( size_t i = 0; i < kNumFrameFields; ++i ) {
+			uint32_t bit = 1u << i;
+			if ( ( fields & bit ) != 0 && mCounts[ i ] > 0 && --mCounts[ i ] == 0 ) {
+				mHeld &= ~bit;
+			}
+		}
+	}
+
+	size_t				mCounts[ kNumFrameFields ];
+	atomic<uint32_t>	mHeld;
+	mutex				mMutex;
+};
+
+FieldSubscription::FieldSubscription( const shared_ptr<Counter>& counter, uint32_t fields, const PolicySubscriptionRef& images )
+: mCounter( counter ), mFields( fields ), mImages( images )
+{
+	mCounter->acquire( mFields );
+}
+
+FieldSubscription::~FieldSubscription()
+{
+	mCounter->release( mFields );
+}
+
+uint32_t FieldSubscription::getFields() const
+{
+	return mFields;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameFilter filterHands()
+{
+	return []( const Leap::Frame& frame )
+	{
+		return !frame.hands().isEmpty();
+	};
+}
+
+FrameFilter filterEveryNth( uint32_t n )
+{
+	uint32_t count = 0;
+	n = max( n, 1u );
+	return [ count, n ]( const Leap::Frame& frame ) mutable
+	{
+		return count++ % n == 0;
+	};
+}
+
+// Frames for worker and task executor subscribers go through a one 
+// frame mailbox. A newer frame replaces an unclaimed one. Filter and 
+// handler calls register their thread in mCallers, so stop() can wait 
+// them out without either call holding a lock the other needs.
+struct FrameSubscription::Subscriber : public enable_shared_from_this<FrameSubscription::Subscriber>
+{
+	Subscriber( const FrameHandler& handler, FrameExecutor executor, const TaskExecutor& taskExecutor, const FrameFilter& filter )
+	: mBusy( false ), mConnected( true ), mExecutor( executor ), mFilter( filter ), 
+	mHandler( handler ), mPending( false ), mSkipped( 0 ), mTaskExecutor( taskExecutor )
+	{
+	}
+
+	~Subscriber()
+	{
+		stop();
+	}
+
+	bool isQueued() const
+	{
+		return mExecutor == EXECUTOR_WORKER || mTaskExecutor;
+	}
+
+	void start()
+	{
+		if ( mExecutor == EXECUTOR_WORKER ) {
+			// The thread keeps the subscriber alive until stop()
+			mThread = thread( &Subscriber::run, shared_from_this() );
+		}
+	}
+
+	void stop()
+	{
+		// Wait out filter and handler calls on other threads, then 
+		// release what they captured. A handler stopping itself can't be 
+		// released while it runs; the destructor does it instead.
+		const thread::id self = this_thread::get_id();
+		bool calling = false;
+		{
+			unique_lock<mutex> lock( mMutex );
+			mConnected = false;
+			mCondition.notify_all();
+			mCondition.wait( lock, [ this, self ]()
+			{
+				return count( mCallers.begin(), mCallers.end(), self ) == (ptrdiff_t)mCallers.size();
+			} );
+			calling = !mCallers.empty();
+		}
+		if ( !calling ) {
+			mFilter		= nullptr;
+			mHandler	= nullptr;
+		}
+		if ( mThread.joinable() ) {
+			if ( mThread.get_id() == this_thread::get_id() ) {
+				mThread.detach();
+			} else {
+				mThread.join();
+			}
+		}
+	}
+
+	// Runs on the thread delivering the frame
+	void deliver( const Leap::Frame& frame )
+	{
+		if ( !isQueued() ) {
+			invoke( frame, true );
+			return;
+		}
+		if ( !enter() ) {
+			return;
+		}
+		const bool accepted = !mFilter || mFilter( frame );
+		leave();
+		if ( accepted ) {
+			post( frame );
+		}
+	}
+
+	void invoke( const Leap::Frame& frame, bool filter )
+	{
+		if ( !enter() ) {
+			return;
+		}
+		if ( !filter || !mFilter || mFilter( frame ) ) {
+			mHandler( frame );
+		}
+		leave();
+	}
+
+	// Registers a filter or handler call. Returns false once stopped.
+	bool enter()
+	{
+		lock_guard<mutex> lock( mMutex );
+		if ( !mConnected ) {
+			return false;
+		}
+		mCallers.push_back( this_thread::get_id() );
+		return true;
+	}
+
+	void leave()
+	{
+		{
+			lock_guard<mutex> lock( mMutex );
+			mCallers.erase( find( mCallers.begin(), mCallers.end(), this_thread::get_id() ) );
+		}
+		mCondition.notify_all();
+	}
+
+	void post( const Leap::Frame& frame )
+	{
+		bool submit = false;
+		{
+			lock_guard<mutex> lock( mMutex );
+			if ( mPending ) {
+				++mSkipped;
+			}
+			mFrame		= frame;
+			mPending	= true;
+			if ( mTaskExecutor && !mBusy ) {
+				mBusy	= true;
+				submit	= true;
+			}
+		}
+		if ( submit ) {
+			shared_ptr<Subscriber> self = shared_from_this();
+			mTaskExecutor( [ self ]()
+			{
+				self->drain();
+			} );
+		} else {
+			mCondition.notify_one();
+		}
+	}
+
+	// Runs on the task executor until the mailbox is empty
+	void drain()
+	{
+		while ( true ) {
+			Leap::Frame frame;
+			{
+				lock_guard<mutex> lock( mMutex );
+				if ( !mPending || !mConnected ) {
+					mBusy = false;
+					return;
+				}
+				frame		= mFrame;
+				mFrame		= Leap::Frame();
+				mPending	= false;
+			}
+			invoke( frame, false );
+		}
+	}
+
+	void run()
+	{
+		while ( true ) {
+			Leap::Frame frame;
+			{
+				unique_lock<mutex> lock( mMutex );
+				mCondition.wait( lock, [ this ]()
+				{
+					return mPending || !mConnected;
+				} );
+				if ( !mConnected ) {
+					return;
+				}
+				frame		= mFrame;
+				mFrame		= Leap::Frame();
+				mPending	= false;
+			}
+			invoke( frame, false );
+		}
+	}
+
+	bool					mBusy;
+	vector<thread::id>		mCallers;
+	condition_variable		mCondition;
+	atomic<bool>			mConnected;
+	FrameExecutor			mExecutor;
+	FrameFilter				mFilter;
+	Leap::Frame				mFrame;
+	FrameHandler			mHandler;
+	mutex					mMutex;
+	bool					mPending;
+	atomic<uint64_t>		mSkipped;
+	TaskExecutor			mTaskExecutor;
+	thread					mThread;
+};
+
+FrameSubscription::FrameSubscription( const shared_ptr<Subscriber>& subscriber )
+: mSubscriber( subscriber )
+{
+}
+
+FrameSubscription::~FrameSubscription()
+{
+	disconnect();
+}
+
+void FrameSubscription::disconnect()
+{
+	mSubscriber->stop();
+}
+
+bool FrameSubscription::isConnected() const
+{
+	return mSubscriber->mConnected;
+}
+
+uint64_t FrameSubscription::getNumSkipped() const
+{
+	return mSubscriber->mSkipped;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameWaiter::FrameWaiter()
+: mDevice( nullptr ), mNext( nullptr ), mPrev( nullptr )
+{
+}
+
+FrameWaiter::~FrameWaiter()
+{
+	if ( mDevice != nullptr ) {
+		mDevice->removeWaiter( this );
+	}
+}
+
+bool FrameWaiter::isWaiting() const
+{
+	return mDevice != nullptr;
+}
+
+void FrameWaiter::cancel()
+{
+}
+
+#if defined( LEAPMOTION_COROUTINES )
+bool GestureAwaiter::test( const Leap::Frame& frame )
+{
+	const Leap::GestureList& gestures = frame.gestures();
+	for ( Leap::GestureList::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
+		const Leap::Gesture& gesture = *iter;
+		if ( gesture.type() == mType && gesture.state() == Leap::Gesture::STATE_STOP ) {
+			mFrame		= frame;
+			mGesture	= gesture;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HandLostAwaiter::test( const Leap::Frame& frame )
+{
+	if ( frame.hand( mId ).isValid() ) {
+		return false;
+	}
+	mFrame = frame;
+	return true;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+ClockSync::ClockSync( size_t window )
+: mAppOrigin( 0.0 ), mNext( 0 ), mNumSamples( 0 ), mSdkOrigin( 0.0 ), mSequence( 0 ), 
+mSlope( 1.0 ), mWindow( max( window, (size_t)1 ) )
+{
+}
+
+void ClockSync::addSample( int64_t sdkTime, double appTime )
+{
+	if ( mSamples.size() < mWindow ) {
+		mSamples.push_back( make_pair( sdkTime, appTime ) );
+	} else {
+		mSamples[ mNext ] = make_pair( sdkTime, appTime );
+	}
+	mNext = ( mNext + 1 ) % mWindow;
+
+	// Fit about the means, in seconds, to keep precision
+	size_t count	= mSamples.size();
+	double sdkMean	= 0.0;
+	double appMean	= 0.0;
+	for ( size_t i = 0; i < count; ++i ) {
+		sdkMean += (double)mSamples[ i ].first;
+		appMean += mSamples[ i ].second;
+	}
+	sdkMean /= (double)count;
+	appMean /= (double)count;
+	double covariance	= 0.0;
+	double variance		= 0.0;
+	for ( size_t i = 0; i < count; ++i ) {
+		double x	= ( (double)mSamples[ i ].first - sdkMean ) * 1.0e-6;
+		covariance	+= x * ( mSamples[ i ].second - appMean );
+		variance	+= x * x;
+	}
+
+	// Until samples span some time, assume the clocks run at the same rate
+	double slope = variance > 1.0e-4 ? covariance / variance : 1.0;
+
+	uint32_t seq = mSequence.load( memory_order_relaxed );
+	mSequence.store( seq + 1, memory_order_relaxed );
+	atomic_thread_fence( memory_order_release );
+	mAppOrigin.store( appMean, memory_order_relaxed );
+	mSdkOrigin.store( sdkMean, memory_order_relaxed );
+	mSlope.store( slope, memory_order_relaxed );
+	mSequence.store( seq + 2, memory_order_release );
+	mNumSamples.store( count, memory_order_release );
+}
+
+void ClockSync::reset()
+{
+	mNext = 0;
+	mSamples.clear();
+	mNumSamples.store( 0, memory_order_release );
+}
+
+ClockSync::Fit ClockSync::load() const
+{
+	Fit fit;
+	while ( true ) {
+		uint32_t seq	= mSequence.load( memory_order_acquire );
+		fit.mAppOrigin	= mAppOrigin.load( memory_order_relaxed );
+		fit.mSdkOrigin	= mSdkOrigin.load( memory_order_relaxed );
+		fit.mSlope		= mSlope.load( memory_order_relaxed );
+		atomic_thread_fence( memory_order_acquire );
+		if ( ( seq & 1 ) == 0 && mSequence.load( memory_order_relaxed ) == seq ) {
+			return fit;
+		}
+	}
+}
+
+double ClockSync::toAppTime( int64_t sdkTime ) const
+{
+	Fit fit = load();
+	return fit.mAppOrigin + fit.mSlope * ( (double)sdkTime - fit.mSdkOrigin ) * 1.0e-6;
+}
+
+int64_t ClockSync::toSdkTime( double appTime ) const
+{
+	Fit fit = load();
+	return (int64_t)( fit.mSdkOrigin + ( appTime - fit.mAppOrigin ) / fit.mSlope * 1.0e6 );
+}
+
+double ClockSync::getDrift() const
+{
+	return ( load().mSlope - 1.0 ) * 1.0e6;
+}
+
+size_t ClockSync::getNumSamples() const
+{
+	return mNumSamples.load( memory_order_acquire );
+}
+
+bool ClockSync::isValid() const
+{
+	return getNumSamples() > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+DeviceRef Device::create()
+{
+	return DeviceRef( new Device() );
+}
+
+Device::Device()
+{
+	mFields				= make_shared<FieldSubscription::Counter>();
+	mClockSyncTime		= -1.0;
+	mHistory[ 0 ].mId	= -1;
+	mHistory[ 1 ].mId	= -1;
+	mIdle				= false;
+	mIdleInterval		= 500000;
+	mIdleNotified		= false;
+	mIdleTimeout		= 0;
+	mIdleTimestamp		= -1;
+	mSnapshotDirty		= true;
+	mSubscribers		= make_shared<SubscriberList>();
+	mWaitersHead		= nullptr;
+	mWaitersTail		= nullptr;
+
+	mListener.mDevice	= this;
+	mListener.mMutex	= &mMutex;
+	mController			= new Leap::Controller( mListener );
+	mPolicies			= make_shared<PolicySubscription::Counter>( mController );
+
+	App::get()->getSignalUpdate().connect( bind( &Device::update, this ) );
+}
+
+Device::~Device()
+{
+	mController->removeListener( mListener );
+	disconnectEventHandler();
+	for ( SubscriberList::const_iterator iter = mSubscribers->begin(); iter != mSubscribers->end(); ++iter ) {
+		( *iter )->stop();
+	}
+	// Dequeue before cancelling, as cancelling may free the waiter
+	while ( mWaitersHead != nullptr ) {
+		FrameWaiter* waiter = mWaitersHead;
+		removeWaiter( waiter );
+		waiter->cancel();
+	}
+	{
+		lock_guard<mutex> lock( mPolicies->mMutex );
+		mPolicies->mController = nullptr;
+	}
+}
+
+Leap::Controller* Device::getController() const
+{
+	return mController;
 }
 	
+const InteractionBoxTransform& Device::getInteractionBox() const
+{
+	return mInteractionBox;
+}
+
+const ScreenCalibration& Device::getScreenCalibration()
+{
+	if ( !mScreenCalibration.isValid() ) {
+		mScreenCalibration = ScreenCalibration( mController->locatedScreens() );
+	}
+	return mScreenCalibration;
+}
+
+void Device::invalidateScreenCalibration()
+{
+	mScreenCalibration.invalidate();
+}
+
+PolicySubscriptionRef Device::subscribePolicy( Leap::Controller::PolicyFlag policy )
+{
+	return PolicySubscriptionRef( new PolicySubscription( mPolicies, policy ) );
+}
+
+PolicySubscriptionRef Device::subscribeImages()
+{
+	return subscribePolicy( Leap::Controller::POLICY_IMAGES );
+}
+
+PolicySubscriptionRef Device::subscribeBackgroundFrames()
+{
+	return subscribePolicy( Leap::Controller::POLICY_BACKGROUND_FRAMES );
+}
+
+size_t Device::getNumSubscriptions( Leap::Controller::PolicyFlag policy ) const
+{
+	lock_guard<mutex> lock( mPolicies->mMutex );
+	size_t count = 0;
+	for ( uint32_t i = 0; i < 32; ++i ) {
+		if ( ( policy & ( 1u << i ) ) != 0 ) {
+			count = max( count, mPolicies->mCounts[ i ] );
+		}
+	}
+	return count;
+}
+
+FieldSubscriptionRef Device::subscribeFields( uint32_t fields )
+{
+	PolicySubscriptionRef images;
+	if ( ( fields & FIELD_IMAGES ) != 0 ) {
+		images = subscribeImages();
+	}
+	return FieldSubscriptionRef( new FieldSubscription( mFields, fields, images ) );
+}
+
+uint32_t Device::getSubscribedFields() const
+{
+	return mFields->mHeld;
+}
+
+uint32_t Device::getCaptureFields() const
+{
+	uint32_t fields = getSubscribedFields();
+	return fields == 0 ? (uint32_t)FIELD_ALL : fields;
+}
+
+const FrameSnapshot& Device::getSnapshot()
+{
+	// Recapture if a subscription changed since this frame was captured
+	uint32_t fields = getCaptureFields();
+	if ( mSnapshotDirty || mSnapshot.mFields != ( fields & ~(uint32_t)FIELD_IMAGES ) ) {
+		mSnapshot.capture( mFrame, fields );
+		mSnapshotDirty = false;
+	}
+	return mSnapshot;
+}
+
+const FrameSnapshot& Device::getSnapshot( int64_t timestamp )
+{
+	// Blend the last two dispatched frames rather than walking the 
+	// controller's history, which costs an SDK call per frame
+	const Leap::Frame& newer = mFrame;
+	const Leap::Frame& older = mFramePrevious.isValid() ? mFramePrevious : mFrame;
+	if ( !newer.isValid() ) {
+		mSampled.capture( newer, 0 );
+		return mSampled;
+	}
+
+	const FrameSnapshot& a	= captureHistory( older, newer.id() );
+	const FrameSnapshot& b	= captureHistory( newer, older.id() );
+	int64_t span			= b.mTimestamp - a.mTimestamp;
+	float t					= span <= 0 ? 1.0f : (float)( timestamp - a.mTimestamp ) / (float)span;
+	interpolate( a, b, math<float>::clamp( t, 0.0f, 1.0f ), mSampled );
+	return mSampled;
+}
+
+int64_t Device::getFrameInterval() const
+{
+	if ( !mFrame.isValid() || !mFramePrevious.isValid() ) {
+		return 0;
+	}
+	return mFrame.timestamp() - mFramePrevious.timestamp();
+}
+
+const FrameSnapshot& Device::captureHistory( const Leap::Frame& frame, int64_t keepId )
+{
+	// Snapshots hold the fields they were captured with, so a
+	// subscription added since doesn't get a stale one back
+	int64_t id		= frame.id();
+	uint32_t fields	= getCaptureFields();
+	for ( size_t i = 0; i < 2; ++i ) {
+		if ( mHistory[ i ].mId == id && mHistory[ i ].mFields == ( fields & ~(uint32_t)FIELD_IMAGES ) ) {
+			return mHistory[ i ];
+		}
+	}
+	FrameSnapshot& snapshot = mHistory[ 0 ].mId == keepId ? mHistory[ 1 ] : mHistory[ 0 ];
+	snapshot.capture( frame, fields );
+	return snapshot;
+}
+
+int64_t Device::now() const
+{
+	return mController->now();
+}
+
+const ClockSync& Device::getClockSync() const
+{
+	return mClockSync;
+}
+
 bool Device::hasExited() const
 {
 	return mListener.mExited;
@@ -213,23 +1785,263 @@ bool Device::isInitialized() const
 	return mListener.mInitialized;
 }
 
-void Device::connectEventHandler( const function<void( Leap::Frame )>& eventHandler )
+bool Device::isIdle() const
+{
+	return mIdle;
+}
+
+void Device::setIdleTimeout( double seconds )
+{
+	mIdleTimeout = (int64_t)( max( seconds, 0.0 ) * 1000000.0 );
+}
+
+double Device::getIdleTimeout() const
 {
-	mEventHandler = eventHandler;
+	return (double)mIdleTimeout / 1000000.0;
+}
+
+void Device::setIdleInterval( double seconds )
+{
+	mIdleInterval = (int64_t)( max( seconds, 0.0 ) * 1000000.0 );
+}
+
+double Device::getIdleInterval() const
+{
+	return (double)mIdleInterval / 1000000.0;
+}
+
+signals::Signal<void( bool )>& Device::getSignalIdle()
+{
+	return mSignalIdle;
+}
+
+Leap::Frame Device::waitForFrame( double timeout )
+{
+	unique_lock<mutex> lock( mMutex );
+	uint64_t count = mListener.mFrameCount;
+	mListener.mCondition.wait_for( lock, chrono::duration<double>( timeout ), [ & ]()
+	{
+		return mListener.mFrameCount != count || mListener.mExited;
+	} );
+	if ( mListener.mFrameCount == count || mListener.mExited ) {
+		return Leap::Frame::invalid();
+	}
+	return mListener.mLatestFrame;
+}
+
+bool Device::waitForConnection( double timeout )
+{
+	unique_lock<mutex> lock( mMutex );
+	return mListener.mCondition.wait_for( lock, chrono::duration<double>( timeout ), [ & ]()
+	{
+		return mListener.mConnected || mListener.mExited;
+	} ) && mListener.mConnected;
+}
+
+void Device::addWaiter( FrameWaiter* waiter )
+{
+	if ( waiter->mDevice != nullptr ) {
+		waiter->mDevice->removeWaiter( waiter );
+	}
+	waiter->mDevice	= this;
+	waiter->mNext	= nullptr;
+	waiter->mPrev	= mWaitersTail;
+	if ( mWaitersTail != nullptr ) {
+		mWaitersTail->mNext = waiter;
+	} else {
+		mWaitersHead = waiter;
+	}
+	mWaitersTail = waiter;
+}
+
+void Device::removeWaiter( FrameWaiter* waiter )
+{
+	if ( waiter->mDevice != this ) {
+		return;
+	}
+	if ( waiter->mPrev != nullptr ) {
+		waiter->mPrev->mNext = waiter->mNext;
+	} else {
+		mWaitersHead = waiter->mNext;
+	}
+	if ( waiter->mNext != nullptr ) {
+		waiter->mNext->mPrev = waiter->mPrev;
+	} else {
+		mWaitersTail = waiter->mPrev;
+	}
+	waiter->mDevice	= nullptr;
+	waiter->mNext	= nullptr;
+	waiter->mPrev	= nullptr;
+}
+
+#if defined( LEAPMOTION_COROUTINES )
+FrameAwaiter Device::nextFrame()
+{
+	return FrameAwaiter( this );
+}
+
+GestureAwaiter Device::nextGesture( Leap::Gesture::Type type )
+{
+	return GestureAwaiter( this, type );
+}
+
+HandLostAwaiter Device::untilHandLost( int32_t id )
+{
+	return HandLostAwaiter( this, id );
+}
+#endif
+
+// Runs on the SDK thread for every frame. While idle, lets through one 
+// frame per interval and any frame with a hand.
+bool Device::admit( const Leap::Frame& frame )
+{
+	int64_t timeout		= mIdleTimeout;
+	int64_t timestamp	= frame.timestamp();
+	if ( timeout <= 0 || !frame.hands().isEmpty() ) {
+		mIdle			= false;
+		mIdleTimestamp	= timestamp;
+		return true;
+	}
+	if ( mIdleTimestamp < 0 ) {
+		mIdleTimestamp = timestamp;
+	}
+	if ( !mIdle ) {
+		if ( timestamp - mIdleTimestamp >= timeout ) {
+			mIdle			= true;
+			mIdleTimestamp	= timestamp;
+		}
+		return true;
+	}
+	if ( timestamp - mIdleTimestamp >= mIdleInterval ) {
+		mIdleTimestamp = timestamp;
+		return true;
+	}
+	return false;
+}
+
+FrameSubscriptionRef Device::subscribe( const FrameHandler& handler, FrameExecutor executor, const FrameFilter& filter )
+{
+	return addSubscriber( make_shared<FrameSubscription::Subscriber>( handler, executor, TaskExecutor(), filter ) );
+}
+
+FrameSubscriptionRef Device::subscribe( const FrameHandler& handler, const TaskExecutor& executor, const FrameFilter& filter )
+{
+	return addSubscriber( make_shared<FrameSubscription::Subscriber>( handler, EXECUTOR_DEVICE, executor, filter ) );
+}
+
+FrameSubscriptionRef Device::addSubscriber( const shared_ptr<FrameSubscription::Subscriber>& subscriber )
+{
+	subscriber->start();
+
+	replaceSubscribers( subscriber );
+	return FrameSubscriptionRef( new FrameSubscription( subscriber ) );
+}
+
+void Device::replaceSubscribers( const shared_ptr<FrameSubscription::Subscriber>& subscriber )
+{
+	// Dispatch reads the list without locking, so replace it rather 
+	// than modify it. Disconnected subscribers are dropped here too.
+	lock_guard<mutex> lock( mSubscribersMutex );
+	shared_ptr<SubscriberList> subscribers( new SubscriberList() );
+	for ( SubscriberList::const_iterator iter = mSubscribers->begin(); iter != mSubscribers->end(); ++iter ) {
+		if ( ( *iter )->mConnected ) {
+			subscribers->push_back( *iter );
+		}
+	}
+	if ( subscriber ) {
+		subscribers->push_back( subscriber );
+	}
+	mSubscribers = subscribers;
+}
+
+void Device::dispatch( const Leap::Frame& frame, bool updateThread )
+{
+	shared_ptr<const SubscriberList> subscribers;
+	{
+		lock_guard<mutex> lock( mSubscribersMutex );
+		subscribers = mSubscribers;
+	}
+	bool disconnected = false;
+	for ( SubscriberList::const_iterator iter = subscribers->begin(); iter != subscribers->end(); ++iter ) {
+		FrameSubscription::Subscriber& subscriber = **iter;
+		if ( !subscriber.mConnected ) {
+			disconnected = true;
+		} else if ( ( subscriber.mExecutor == EXECUTOR_UPDATE ) == updateThread ) {
+			subscriber.deliver( frame );
+		}
+	}
+
+	// Don't keep disconnected handlers (and what they capture) alive 
+	// until the next subscribe()
+	if ( disconnected ) {
+		replaceSubscribers( nullptr );
+	}
+}
+
+void Device::connectEventHandler( const FrameHandler& eventHandler )
+{
+	disconnectEventHandler();
+	mEventSubscription = subscribe( eventHandler );
 }
 
 void Device::disconnectEventHandler()
 {
-	mEventHandler = nullptr;
+	if ( mEventSubscription ) {
+		mEventSubscription->disconnect();
+		mEventSubscription.reset();
+	}
 }
 
 void Device::update()
 {
-	lock_guard<mutex> lock( mMutex );
-	if ( mListener.mConnected && mListener.mInitialized && mListener.mNewFrame ) {
-		mEventHandler( mListener.mFrame );
+	// Bracket the SDK read with app clock reads and drop samples 
+	// where the thread was preempted in between
+	double time = getElapsedSeconds();
+	if ( mListener.mConnected && time - mClockSyncTime >= 0.1 ) {
+		int64_t sdkTime	= mController->now();
+		double after	= getElapsedSeconds();
+		if ( after - time < 0.0005 ) {
+			mClockSync.addSample( sdkTime, ( time + after ) * 0.5 );
+			mClockSyncTime = time;
+		}
+	}
+
+	bool idle = mIdle;
+	if ( idle != mIdleNotified ) {
+		mIdleNotified = idle;
+		mPolicies->suspend( idle ? Leap::Controller::POLICY_IMAGES : 0 );
+		mSignalIdle.emit( idle );
+	}
+
+	{
+		lock_guard<mutex> lock( mMutex );
+		if ( !mListener.mConnected || !mListener.mInitialized || !mListener.mNewFrame ) {
+			return;
+		}
+		mFramePrevious	= mFrame;
+		mFrame			= mListener.mFrame;
+		mInteractionBox	= InteractionBoxTransform( mFrame.interactionBox() );
+		mSnapshotDirty	= true;
 		mListener.mNewFrame = false;
 	}
+
+	dispatch( mFrame, true );
+
+	// Dequeue everything this frame satisfies before resuming, so 
+	// waiters queued while resuming wait for the next frame
+	mWaitersReady.clear();
+	for ( FrameWaiter* waiter = mWaitersHead; waiter != nullptr; ) {
+		FrameWaiter* next = waiter->mNext;
+		if ( waiter->test( mFrame ) ) {
+			removeWaiter( waiter );
+			mWaitersReady.push_back( waiter );
+		}
+		waiter = next;
+	}
+	for ( size_t i = 0; i < mWaitersReady.size(); ++i ) {
+		mWaitersReady[ i ]->resume();
+	}
+	mWaitersReady.clear();
 }
 	
 }
@@ -39,9 +39,22 @@
 #include "Leap.h"
 #include "cinder/Channel.h"
 #include "cinder/Matrix.h"
+#include "cinder/Signals.h"
 #include "cinder/Vector.h"
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined( __cpp_impl_coroutine ) && __cpp_impl_coroutine >= 201902L
+#define LEAPMOTION_COROUTINES
+#include <coroutine>
+#include <exception>
+#endif
 
 namespace LeapMotion {
 
@@ -60,6 +73,472 @@ Leap::Matrix		toLeapMatrix( const ci::mat4 m );
 Leap::Vector		toLeapVector( const ci::vec3& v );
 //! Converts a native Leap vector into a Cinder one.
 ci::vec3			toVec3( const Leap::Vector& v );
+/*! Transforms \a count \a positions by affine matrix \a m and writes 
+	them to \a result. \a result may alias \a positions. */
+void				transformPoints( const ci::mat4& m, const ci::vec3* positions, size_t count, ci::vec3* result );
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Plain affine copy of a frame's interaction box. Normalizes and 
+	denormalizes arrays of points without per-point SDK calls. */
+class InteractionBoxTransform
+{
+public:
+	InteractionBoxTransform();
+	//! Captures center and dimensions of \a box.
+	explicit InteractionBoxTransform( const Leap::InteractionBox& box );
+
+	//! Returns center of the box in millimeters.
+	const ci::vec3&		getCenter() const;
+	//! Returns width, height and depth of the box in millimeters.
+	const ci::vec3&		getSize() const;
+	//! Returns true if captured from a valid interaction box.
+	bool				isValid() const;
+
+	/*! Returns matrix mapping device space to 0-1 box space. Multiply 
+		with a screen or world matrix to get a single per-joint transform. */
+	ci::mat4			getNormalizeMatrix() const;
+	//! Returns matrix mapping 0-1 box space to device space.
+	ci::mat4			getDenormalizeMatrix() const;
+
+	//! Equivalent to Leap::InteractionBox::normalizePoint().
+	ci::vec3			normalize( const ci::vec3& position, bool clamp = true ) const;
+	//! Normalizes \a count \a positions into \a result. \a result may alias \a positions.
+	void				normalize( const ci::vec3* positions, size_t count, ci::vec3* result, bool clamp = true ) const;
+	//! Equivalent to Leap::InteractionBox::denormalizePoint().
+	ci::vec3			denormalize( const ci::vec3& position ) const;
+	//! Denormalizes \a count \a positions into \a result. \a result may alias \a positions.
+	void				denormalize( const ci::vec3* positions, size_t count, ci::vec3* result ) const;
+private:
+	ci::vec3			mCenter;
+	ci::vec3			mSize;
+	bool				mValid;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Snapshot of located screen geometry. Projects and intersects arrays 
+	of positions and directions without calling back into the SDK. */
+class ScreenCalibration
+{
+public:
+	ScreenCalibration();
+	//! Captures geometry of every valid screen in \a screens.
+	explicit ScreenCalibration( const Leap::ScreenList& screens );
+
+	//! Returns number of screens in snapshot.
+	size_t				getNumScreens() const;
+	//! Marks snapshot as stale. Device recaptures it on next request.
+	void				invalidate();
+	//! Returns true if snapshot has not been invalidated.
+	bool				isValid() const;
+
+	/*! Projects \a count \a positions onto the closest screen and writes 
+		them to \a result. Set \a normalize to return coordinates in 
+		0-1 screen space. \a clampRatio sets the clamping border in screen 
+		sizes. Equivalent to Leap::Screen::project(). Four positions 
+		at a time with SSE2 where available. */
+	void				project( const ci::vec3* positions, size_t count, ci::vec3* result, 
+								 bool normalize = true, float clampRatio = 1.0f ) const;
+	/*! Intersects \a count rays described by \a positions and \a directions 
+		with the closest screen hit and writes them to \a result. Rays which 
+		miss every screen return zero. Equivalent to Leap::Screen::intersect(). */
+	void				intersect( const ci::vec3* positions, const ci::vec3* directions, size_t count, 
+								   ci::vec3* result, bool normalize = true, float clampRatio = 1.0f ) const;
+	//! Intersects tip rays of every pointable in \a pointables with the closest screen hit.
+	std::vector<ci::vec3>	intersect( const Leap::PointableList& pointables, 
+									   bool normalize = true, float clampRatio = 1.0f ) const;
+private:
+	struct Screen
+	{
+		ci::vec3		mAxisX;
+		ci::vec3		mAxisY;
+		ci::vec3		mInvAxisX;
+		ci::vec3		mInvAxisY;
+		ci::vec3		mNormal;
+		ci::vec3		mOrigin;
+	};
+
+	ci::vec3			toScreen( const Screen& screen, const ci::vec3& v, bool normalize, float clampRatio ) const;
+
+	std::vector<Screen>	mScreens;
+	bool				mValid;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Plain-data copies of tracking data. Snapshots are fixed-size and 
+	trivially copyable, so they can be memcpy'd, stored in shared 
+	memory or sent over the wire without the SDK. */
+struct BoneSnapshot
+{
+	ci::mat3			mBasis;
+	ci::vec3			mNextJoint;
+	ci::vec3			mPrevJoint;
+	float				mWidth;
+};
+
+struct FingerSnapshot
+{
+	BoneSnapshot		mBones[ 4 ];
+	ci::vec3			mDirection;
+	bool				mExtended;
+	int32_t				mId;
+	float				mLength;
+	ci::vec3			mTipPosition;
+	ci::vec3			mTipVelocity;
+	int32_t				mType;
+	float				mWidth;
+};
+
+struct HandSnapshot
+{
+	ci::mat3			mArmBasis;
+	float				mArmWidth;
+	ci::mat3			mBasis;
+	float				mConfidence;
+	ci::vec3			mDirection;
+	ci::vec3			mElbowPosition;
+	FingerSnapshot		mFingers[ 5 ];
+	float				mGrabStrength;
+	int32_t				mId;
+	bool				mLeft;
+	ci::vec3			mPalmNormal;
+	ci::vec3			mPalmPosition;
+	ci::vec3			mPalmVelocity;
+	float				mPalmWidth;
+	float				mPinchStrength;
+	ci::vec3			mStabilizedPalmPosition;
+	float				mTimeVisible;
+	ci::vec3			mWristPosition;
+};
+
+/*! Gesture fields are shared across gesture types. \a mProgress holds 
+	circle turns, tap progress or swipe speed. \a mDirection holds the 
+	circle normal for circle gestures. */
+struct GestureSnapshot
+{
+	ci::vec3			mDirection;
+	int64_t				mDuration;
+	int32_t				mHandId;
+	int32_t				mId;
+	int32_t				mPointableId;
+	ci::vec3			mPosition;
+	float				mProgress;
+	float				mRadius;
+	int32_t				mState;
+	int32_t				mType;
+};
+
+//! Number of FrameField bits. Field n is bit 1 << n.
+static const size_t		kNumFrameFields = 7;
+
+//! Parts of a frame a consumer reads. Combine with |.
+enum FrameField : uint32_t
+{
+	FIELD_PALMS				= 1 << 0,	//!< Palm, hand direction, basis and strengths
+	FIELD_TIPS				= 1 << 1,	//!< Finger tips, directions and extended state
+	FIELD_BONES				= 1 << 2,	//!< Bone joints, bases and widths
+	FIELD_ARMS				= 1 << 3,	//!< Arm basis, width, wrist and elbow
+	FIELD_GESTURES			= 1 << 4,
+	FIELD_IMAGES			= 1 << 5,	//!< Camera images. Not stored in snapshots; sets the images policy
+	FIELD_INTERACTION_BOX	= 1 << 6,
+	FIELD_ALL				= ( 1 << kNumFrameFields ) - 1
+};
+
+struct FrameSnapshot
+{
+	static const size_t	kMaxGestures	= 8;
+	static const size_t	kMaxHands		= 4;
+
+	/*! Copies tracking data from \a frame. Extra hands and gestures are 
+		dropped. Only \a fields are read from the SDK; the rest are zero. 
+		Hand ids, sides, confidence and time visible come with any hand 
+		field, as do finger ids and types with tips or bones. */
+	void				capture( const Leap::Frame& frame, uint32_t fields = FIELD_ALL );
+
+	ci::vec3			mBoxCenter;
+	ci::vec3			mBoxSize;
+	uint32_t			mFields;
+	float				mFramesPerSecond;
+	GestureSnapshot		mGestures[ kMaxGestures ];
+	HandSnapshot		mHands[ kMaxHands ];
+	int64_t				mId;
+	uint32_t			mNumGestures;
+	uint32_t			mNumHands;
+	int64_t				mTimestamp;
+};
+
+/*! Blends \a a and \a b into \a result at \a t (zero is \a a). Hands are 
+	matched by id. Positions, velocities and scalars are lerped and bases 
+	slerped. Hands only in \a b, gestures and fields missing from 
+	either frame are copied from \a b. */
+void				interpolate( const FrameSnapshot& a, const FrameSnapshot& b, float t, FrameSnapshot& result );
+
+/*! World matrices for one hand: 20 finger bones (finger type * 4 + 
+	bone type), then palm and arm. Columns are the SDK bases, scaled by 
+	width (x, y) and length (z) for bones and the arm when requested, 
+	and translated to the bone center or palm. Left hand z bases are 
+	negated so both hands follow the right-hand rule. The array has 
+	std140 mat4 layout and can be copied straight into a UBO. */
+struct HandMatrices
+{
+	static const size_t	kArm		= 21;
+	static const size_t	kNumBones	= 22;
+	static const size_t	kPalm		= 20;
+
+	ci::mat4			mBones[ kNumBones ];
+};
+
+/*! Computes matrices for up to \a maxHands hands in \a frame into 
+	\a result in one pass. Returns number of hands written. Set 
+	\a scaled to false for rigid transforms. */
+size_t				computeHandMatrices( const Leap::Frame& frame, HandMatrices* result, size_t maxHands, bool scaled = true );
+//! Snapshot variant. Requires palms, bones and arms.
+size_t				computeHandMatrices( const FrameSnapshot& frame, HandMatrices* result, size_t maxHands, bool scaled = true );
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Maps Leap ids (hands, fingers, tools, gestures) to densely packed 
+	values. Lookup is O(1), values iterate contiguously and ids which 
+	are not touched for a number of update() calls are released, so 
+	ever-growing SDK ids do not leak. Handles carry a generation count 
+	and fail to resolve once their slot has been reused. */
+template<typename T>
+class TrackingMap
+{
+public:
+	typedef typename std::vector<T>::iterator		iterator;
+	typedef typename std::vector<T>::const_iterator	const_iterator;
+
+	struct Handle
+	{
+		Handle( uint32_t slot = 0xFFFFFFFF, uint32_t generation = 0 )
+		: mGeneration( generation ), mSlot( slot ) {}
+		uint32_t	mGeneration;
+		uint32_t	mSlot;
+	};
+
+	//! Ids not touched for \a expiry calls to update() are released.
+	explicit TrackingMap( uint32_t expiry = 30 )
+	: mExpiry( expiry ), mFrame( 0 )
+	{
+	}
+
+	iterator		begin()			{ return mValues.begin(); }
+	const_iterator	begin() const	{ return mValues.begin(); }
+	iterator		end()			{ return mValues.end(); }
+	const_iterator	end() const		{ return mValues.end(); }
+	bool			empty() const	{ return mValues.empty(); }
+	size_t			size() const	{ return mValues.size(); }
+
+	//! Removes all values.
+	void clear()
+	{
+		for ( size_t i = 0; i < mSlots.size(); ++i ) {
+			if ( mSlots[ i ].mDense != kInvalid ) {
+				release( (uint32_t)i );
+			}
+		}
+		mLookup.clear();
+	}
+
+	//! Returns value for \a id, or nullptr. Does not mark \a id as seen.
+	T* find( int32_t id )
+	{
+		std::unordered_map<int32_t, uint32_t>::const_iterator iter = mLookup.find( id );
+		return iter == mLookup.end() ? nullptr : &mValues[ mSlots[ iter->second ].mDense ];
+	}
+
+	//! Returns value for \a handle, or nullptr if it has expired.
+	T* get( const Handle& handle )
+	{
+		if ( handle.mSlot >= mSlots.size() ) {
+			return nullptr;
+		}
+		const Slot& slot = mSlots[ handle.mSlot ];
+		return slot.mDense == kInvalid || slot.mGeneration != handle.mGeneration ? nullptr : &mValues[ slot.mDense ];
+	}
+
+	//! Returns a generation-checked handle to \a id's value.
+	Handle getHandle( int32_t id ) const
+	{
+		std::unordered_map<int32_t, uint32_t>::const_iterator iter = mLookup.find( id );
+		return iter == mLookup.end() ? Handle() : Handle( iter->second, mSlots[ iter->second ].mGeneration );
+	}
+
+	//! Returns id of the value at dense index \a i.
+	int32_t getId( size_t i ) const
+	{
+		return mIds[ i ];
+	}
+
+	//! Adds or replaces value for \a id and marks it as seen.
+	T& insert( int32_t id, const T& value )
+	{
+		T* existing = touch( id );
+		if ( existing != nullptr ) {
+			*existing = value;
+			return *existing;
+		}
+
+		uint32_t slot;
+		if ( mFree.empty() ) {
+			slot = (uint32_t)mSlots.size();
+			mSlots.push_back( Slot() );
+		} else {
+			slot = mFree.back();
+			mFree.pop_back();
+		}
+		mSlots[ slot ].mDense = (uint32_t)mValues.size();
+		mLookup[ id ] = slot;
+		mIds.push_back( id );
+		mLastSeen.push_back( mFrame );
+		mOwners.push_back( slot );
+		mValues.push_back( value );
+		return mValues.back();
+	}
+
+	//! Removes \a id. Returns false if it was not present.
+	bool erase( int32_t id )
+	{
+		std::unordered_map<int32_t, uint32_t>::iterator iter = mLookup.find( id );
+		if ( iter == mLookup.end() ) {
+			return false;
+		}
+		release( iter->second );
+		mLookup.erase( iter );
+		return true;
+	}
+
+	//! Returns value for \a id and marks it as seen, or nullptr.
+	T* touch( int32_t id )
+	{
+		std::unordered_map<int32_t, uint32_t>::const_iterator iter = mLookup.find( id );
+		if ( iter == mLookup.end() ) {
+			return nullptr;
+		}
+		uint32_t i		= mSlots[ iter->second ].mDense;
+		mLastSeen[ i ]	= mFrame;
+		return &mValues[ i ];
+	}
+
+	/*! Advances the frame counter and releases ids which have not been 
+		touched for the expiry period. Call once per tracking frame. */
+	void update()
+	{
+		++mFrame;
+		for ( size_t i = mValues.size(); i > 0; --i ) {
+			if ( mFrame - mLastSeen[ i - 1 ] > mExpiry ) {
+				mLookup.erase( mIds[ i - 1 ] );
+				release( mOwners[ i - 1 ] );
+			}
+		}
+	}
+
+	uint32_t	getExpiry() const			{ return mExpiry; }
+	void		setExpiry( uint32_t v )		{ mExpiry = v; }
+private:
+	static const uint32_t kInvalid = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		Slot() : mDense( kInvalid ), mGeneration( 0 ) {}
+		uint32_t	mDense;
+		uint32_t	mGeneration;
+	};
+
+	// Swaps last value into the hole so storage stays contiguous
+	void release( uint32_t slot )
+	{
+		uint32_t i		= mSlots[ slot ].mDense;
+		uint32_t last	= (uint32_t)mValues.size() - 1;
+		if ( i != last ) {
+			mIds[ i ]		= mIds[ last ];
+			mLastSeen[ i ]	= mLastSeen[ last ];
+			mOwners[ i ]	= mOwners[ last ];
+			mValues[ i ]	= std::move( mValues[ last ] );
+			mSlots[ mOwners[ i ] ].mDense = i;
+		}
+		mIds.pop_back();
+		mLastSeen.pop_back();
+		mOwners.pop_back();
+		mValues.pop_back();
+
+		mSlots[ slot ].mDense = kInvalid;
+		++mSlots[ slot ].mGeneration;
+		mFree.push_back( slot );
+	}
+
+	uint32_t								mExpiry;
+	std::vector<uint32_t>					mFree;
+	uint32_t								mFrame;
+	std::vector<int32_t>					mIds;
+	std::vector<uint32_t>					mLastSeen;
+	std::unordered_map<int32_t, uint32_t>	mLookup;
+	std::vector<uint32_t>					mOwners;
+	std::vector<Slot>						mSlots;
+	std::vector<T>							mValues;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Maps SDK hand ids, which change every time tracking drops out, to 
+	stable ids. A new SDK hand takes over the stable id of a recently 
+	lost hand on the same side if its palm is near where the lost palm 
+	was heading. Candidate pairs are matched greedily by distance, so 
+	each update is O(hands^2). */
+class HandIdentityTracker
+{
+public:
+	/*! Lost hands are matched within \a maxDistance millimeters of 
+		their predicted palm position for \a maxGap seconds. */
+	explicit HandIdentityTracker( float maxDistance = 80.0f, double maxGap = 0.5 );
+
+	//! Updates tracks from \a frame. Call once per frame.
+	void				update( const Leap::Frame& frame );
+	//! Updates tracks from \a frame. Requires palms.
+	void				update( const FrameSnapshot& frame );
+	//! Forgets all hands. Stable ids are not reused.
+	void				clear();
+
+	//! Returns stable id for SDK hand \a id, or -1 if it is not in the last frame.
+	int32_t				getStableId( int32_t id ) const;
+	//! Returns number of hands in the last frame.
+	size_t				getNumHands() const;
+
+	float				getMaxDistance() const;
+	void				setMaxDistance( float v );
+	double				getMaxGap() const;
+	void				setMaxGap( double v );
+protected:
+	struct Track
+	{
+		bool			mActive;
+		int32_t			mId;
+		bool			mLeft;
+		ci::vec3		mPosition;
+		int32_t			mStableId;
+		int64_t			mTimestamp;
+		ci::vec3		mVelocity;
+	};
+
+	struct Candidate
+	{
+		float			mDistance;
+		uint32_t		mHand;
+		uint32_t		mTrack;
+	};
+
+	void				update( int64_t timestamp );
+
+	std::vector<Candidate>	mCandidates;
+	float				mMaxDistance;
+	double				mMaxGap;
+	int32_t				mNextId;
+	std::vector<Track>	mObserved;
+	std::vector<Track>	mTracks;
+};
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -77,20 +556,379 @@ protected:
 	virtual void	onFocusLost( const Leap::Controller& controller );
 	virtual void	onInit( const Leap::Controller& controller );
 	
-	volatile bool	mConnected;
-	volatile bool	mExited;
-	volatile bool	mFocused;
-	volatile bool	mInitialized;
-	std::mutex*		mMutex;
-	volatile bool	mNewFrame;
+	std::condition_variable	mCondition;
+	std::atomic<bool>		mConnected;
+	std::atomic<bool>		mExited;
+	std::atomic<bool>		mFocused;
+	uint64_t				mFrameCount;
+	class Device*			mDevice;
+	std::atomic<bool>		mInitialized;
+	std::mutex*				mMutex;
+	std::atomic<bool>		mNewFrame;
 
-	Leap::Frame		mFrame;
+	Leap::Frame				mFrame;
+	Leap::Frame				mLatestFrame;
 
 	friend class	Device;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+typedef std::shared_ptr<class PolicySubscription> PolicySubscriptionRef;
+
+/*! Holds a controller policy on behalf of one consumer. The policy is 
+	set while at least one subscription to it exists and cleared when 
+	the last one is released. Create with Device::subscribePolicy(). */
+class PolicySubscription
+{
+public:
+	~PolicySubscription();
+
+	//! Returns policy held by this subscription.
+	Leap::Controller::PolicyFlag	getPolicy() const;
+protected:
+	struct Counter;
+
+	PolicySubscription( const std::shared_ptr<Counter>& counter, Leap::Controller::PolicyFlag policy );
+
+	std::shared_ptr<Counter>		mCounter;
+	Leap::Controller::PolicyFlag	mPolicy;
+
+	friend class					Device;
+	friend class					FieldSubscription;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class FieldSubscription> FieldSubscriptionRef;
+
+/*! Declares the frame fields one consumer reads. Device::getSnapshot() 
+	captures the union of all live subscriptions. Subscribing to 
+	FIELD_IMAGES also holds the images policy. Create with 
+	Device::subscribeFields(). */
+class FieldSubscription
+{
+public:
+	~FieldSubscription();
+
+	//! Returns fields held by this subscription.
+	uint32_t						getFields() const;
+protected:
+	struct Counter;
+
+	FieldSubscription( const std::shared_ptr<Counter>& counter, uint32_t fields, const PolicySubscriptionRef& images );
+
+	std::shared_ptr<Counter>		mCounter;
+	uint32_t						mFields;
+	PolicySubscriptionRef			mImages;
+
+	friend class					Device;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Intrusive node which Device::update() checks against each dispatched 
+	frame. Once test() accepts a frame the waiter is dequeued and 
+	resume() is called on the update thread. Base of the coroutine 
+	awaiters, and usable from C++11 by overriding test() and resume(). 
+	A waiter dequeues itself when destroyed. If the device is destroyed 
+	first, queued waiters are dequeued and cancel() is called instead. */
+class FrameWaiter
+{
+public:
+	FrameWaiter();
+	virtual ~FrameWaiter();
+
+	//! Not copyable. The device's queue links waiters by address.
+	FrameWaiter( const FrameWaiter& ) = delete;
+	FrameWaiter&		operator=( const FrameWaiter& ) = delete;
+
+	//! Returns true while queued on a device.
+	bool				isWaiting() const;
+protected:
+	//! Returns true to be dequeued and resumed. Must not touch the device.
+	virtual bool		test( const Leap::Frame& frame ) = 0;
+	virtual void		resume() = 0;
+	/*! Called from ~Device() on a waiter which was never resumed. The 
+		waiter is already dequeued and may delete itself. */
+	virtual void		cancel();
+
+	class Device*		mDevice;
+	FrameWaiter*		mNext;
+	FrameWaiter*		mPrev;
+
+	friend class		Device;
+};
+
+#if defined( LEAPMOTION_COROUTINES )
+class FrameAwaiter;
+class GestureAwaiter;
+class HandLostAwaiter;
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Callable wrapper like std::function which keeps small callables 
+	(a lambda capturing a few pointers or references, or an object and 
+	member function pointer) in inline storage. Larger callables are 
+	boxed once when the delegate is made. Calling never allocates. */
+template<typename Signature>
+class Delegate;
+
+template<typename R, typename... Args>
+class Delegate<R( Args... )>
+{
+public:
+	//! Callables up to this many bytes are stored inline.
+	static const size_t kSize = sizeof( void* ) * 4;
+
+	Delegate()
+	: mInvoke( nullptr ), mManage( nullptr )
+	{
+	}
+
+	Delegate( std::nullptr_t )
+	: mInvoke( nullptr ), mManage( nullptr )
+	{
+	}
+
+	Delegate( const Delegate& rhs )
+	: mInvoke( nullptr ), mManage( nullptr )
+	{
+		*this = rhs;
+	}
+
+	//! Wraps \a callable. Empty std::functions and null function pointers make an empty delegate.
+	template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+	Delegate( F&& callable )
+	: mInvoke( nullptr ), mManage( nullptr )
+	{
+		typedef typename std::decay<F>::type Callable;
+		if ( isEmpty( callable ) ) {
+			return;
+		}
+		typedef std::integral_constant<bool, sizeof( Callable ) <= sizeof( Storage ) && 
+			std::alignment_of<Callable>::value <= std::alignment_of<Storage>::value> Fits;
+		construct<Callable>( std::forward<F>( callable ), Fits() );
+	}
+
+	~Delegate()
+	{
+		reset();
+	}
+
+	Delegate& operator=( const Delegate& rhs )
+	{
+		if ( this != &rhs ) {
+			reset();
+			if ( rhs.mManage != nullptr ) {
+				rhs.mManage( &mStorage, &rhs.mStorage );
+			}
+			mInvoke = rhs.mInvoke;
+			mManage = rhs.mManage;
+		}
+		return *this;
+	}
+
+	Delegate& operator=( std::nullptr_t )
+	{
+		reset();
+		return *this;
+	}
+
+	R operator()( Args... args ) const
+	{
+		return mInvoke( mStorage, std::forward<Args>( args )... );
+	}
+
+	explicit operator bool() const
+	{
+		return mInvoke != nullptr;
+	}
+protected:
+	typedef typename std::aligned_storage<kSize>::type Storage;
+
+	typedef R	( *Invoke )( Storage& storage, Args... args );
+	//! Copies \a src into \a dest, or destroys \a dest if \a src is null.
+	typedef void	( *Manage )( Storage* dest, const Storage* src );
+
+	template<typename F>
+	struct Inline
+	{
+		static R invoke( Storage& storage, Args... args )
+		{
+			return ( *reinterpret_cast<F*>( &storage ) )( std::forward<Args>( args )... );
+		}
+
+		static void manage( Storage* dest, const Storage* src )
+		{
+			if ( src != nullptr ) {
+				new ( dest ) F( *reinterpret_cast<const F*>( src ) );
+			} else {
+				reinterpret_cast<F*>( dest )->~F();
+			}
+		}
+	};
+
+	template<typename F>
+	struct Boxed
+	{
+		static R invoke( Storage& storage, Args... args )
+		{
+			return ( **reinterpret_cast<F**>( &storage ) )( std::forward<Args>( args )... );
+		}
+
+		static void manage( Storage* dest, const Storage* src )
+		{
+			if ( src != nullptr ) {
+				new ( dest ) F*( new F( **reinterpret_cast<F* const*>( src ) ) );
+			} else {
+				delete *reinterpret_cast<F**>( dest );
+			}
+		}
+	};
+
+	template<typename C, typename F>
+	void construct( F&& callable, std::true_type )
+	{
+		new ( &mStorage ) C( std::forward<F>( callable ) );
+		mInvoke = &Inline<C>::invoke;
+		mManage = &Inline<C>::manage;
+	}
+
+	template<typename C, typename F>
+	void construct( F&& callable, std::false_type )
+	{
+		new ( &mStorage ) C*( new C( std::forward<F>( callable ) ) );
+		mInvoke = &Boxed<C>::invoke;
+		mManage = &Boxed<C>::manage;
+	}
+
+	template<typename F>
+	static bool		isEmpty( const F& ) { return false; }
+	template<typename S>
+	static bool		isEmpty( const std::function<S>& callable ) { return !callable; }
+	template<typename T>
+	static bool		isEmpty( T* callable ) { return callable == nullptr; }
+
+	void reset()
+	{
+		if ( mManage != nullptr ) {
+			mManage( &mStorage, nullptr );
+		}
+		mInvoke = nullptr;
+		mManage = nullptr;
+	}
+
+	Invoke			mInvoke;
+	Manage			mManage;
+	mutable Storage	mStorage;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+//! Thread a frame subscriber runs on.
+enum FrameExecutor : uint32_t
+{
+	EXECUTOR_UPDATE,	//!< App update thread, from Device::update()
+	EXECUTOR_DEVICE,	//!< SDK thread, as each frame arrives. Keep handlers short.
+	EXECUTOR_WORKER		//!< Dedicated thread per subscriber
+};
+
+// Frames pass by reference, so dispatch to many subscribers doesn't
+// touch the frame's reference count or the heap.
+typedef Delegate<void( const Leap::Frame& )>				FrameHandler;
+typedef Delegate<bool( const Leap::Frame& )>				FrameFilter;
+typedef std::function<void( const std::function<void()>& )>	TaskExecutor;
+
+//! Accepts frames containing at least one hand.
+FrameFilter				filterHands();
+//! Accepts every \a n th frame.
+FrameFilter				filterEveryNth( uint32_t n );
+
+typedef std::shared_ptr<class FrameSubscription> FrameSubscriptionRef;
+
+/*! A frame handler registered with Device::subscribe(). Disconnects 
+	when released. Handlers off the update thread keep at most one 
+	frame pending; a busy handler skips to the newest frame instead of 
+	delaying other subscribers. */
+class FrameSubscription
+{
+public:
+	~FrameSubscription();
+
+	/*! Stops delivery. Once this returns the handler and filter are not 
+		running and won't be called again, and have been released. Waits 
+		for a call in progress on another thread and joins the worker 
+		thread, unless called from the handler itself. */
+	void				disconnect();
+	bool				isConnected() const;
+	//! Returns number of frames replaced before a busy handler took them.
+	uint64_t			getNumSkipped() const;
+protected:
+	struct Subscriber;
+
+	FrameSubscription( const std::shared_ptr<Subscriber>& subscriber );
+
+	std::shared_ptr<Subscriber>	mSubscriber;
+
+	friend class		Device;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Maps between the SDK clock (frame timestamps and Controller::now(), 
+	in microseconds) and the app clock (app::getElapsedSeconds()). A 
+	line is fit by least squares through recent pairs of readings, 
+	giving offset and drift. The fit is published under a sequence 
+	lock, so conversions are O(1) and lock-free from any thread. */
+class ClockSync
+{
+public:
+	//! Fits over the last \a window samples.
+	explicit ClockSync( size_t window = 64 );
+
+	/*! Adds readings of both clocks taken at the same instant. Call 
+		from one thread at a time. */
+	void				addSample( int64_t sdkTime, double appTime );
+	//! Clears all samples.
+	void				reset();
+
+	//! Converts SDK time in microseconds to app seconds.
+	double				toAppTime( int64_t sdkTime ) const;
+	//! Converts app seconds to SDK time in microseconds.
+	int64_t				toSdkTime( double appTime ) const;
+
+	//! Returns rate difference between the clocks in parts per million.
+	double				getDrift() const;
+	//! Returns number of samples in the fit.
+	size_t				getNumSamples() const;
+	//! Returns true once a sample has been added.
+	bool				isValid() const;
+protected:
+	//! app = mAppOrigin + mSlope * ( sdk - mSdkOrigin ) * 1e-6
+	struct Fit
+	{
+		double			mAppOrigin;
+		double			mSdkOrigin;
+		double			mSlope;
+	};
+
+	Fit					load() const;
+
+	std::atomic<double>	mAppOrigin;
+	size_t				mNext;
+	std::atomic<size_t>	mNumSamples;
+	//! Ring of ( SDK, app ) readings. Only touched by the writer.
+	std::vector<std::pair<int64_t, double>>	mSamples;
+	std::atomic<double>	mSdkOrigin;
+	std::atomic<uint32_t>	mSequence;
+	std::atomic<double>	mSlope;
+	size_t				mWindow;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
 typedef std::shared_ptr<class Device> DeviceRef;
 	
 //! A class representing and managing a Leap device, controller and listener.
@@ -99,10 +937,50 @@ class Device
 public:
 	//! Creates and returns device instance.
 	static DeviceRef	create();
+	//! Cancels queued waiters, destroying coroutines suspended on this device without resuming them.
 	~Device();
 	
 	//! Returns LEAP controller associated with this device's listener.
 	Leap::Controller*	getController() const;
+	//! Returns interaction box of the last dispatched frame.
+	const InteractionBoxTransform&	getInteractionBox() const;
+	/*! Returns snapshot of located screens. Captured on first call and 
+		after invalidateScreenCalibration(). */
+	const ScreenCalibration&	getScreenCalibration();
+	//! Forces screen snapshot to be recaptured (eg, after recalibrating).
+	void				invalidateScreenCalibration();
+
+	/*! Returns a subscription which keeps \a policy set until it and 
+		every other subscription to \a policy are released. */
+	PolicySubscriptionRef	subscribePolicy( Leap::Controller::PolicyFlag policy );
+	//! Subscribes to camera images. Shorthand for subscribePolicy( POLICY_IMAGES ).
+	PolicySubscriptionRef	subscribeImages();
+	//! Subscribes to frames while unfocused. Shorthand for subscribePolicy( POLICY_BACKGROUND_FRAMES ).
+	PolicySubscriptionRef	subscribeBackgroundFrames();
+	//! Returns number of live subscriptions to \a policy.
+	size_t				getNumSubscriptions( Leap::Controller::PolicyFlag policy ) const;
+
+	//! Returns a subscription declaring that the caller reads \a fields (see FrameField).
+	FieldSubscriptionRef	subscribeFields( uint32_t fields );
+	//! Returns union of all subscribed fields.
+	uint32_t			getSubscribedFields() const;
+	/*! Returns snapshot of the last dispatched frame holding the 
+		subscribed fields, or every field if there are no subscriptions. 
+		Captured on first call after each frame or change in subscribed 
+		fields, and shared by all callers. */
+	const FrameSnapshot&	getSnapshot();
+	/*! Returns snapshot interpolated to \a timestamp (SDK clock, see 
+		now()) between the last two dispatched frames. Times outside them 
+		clamp, so sample getFrameInterval() behind now() for smooth motion 
+		at any display rate. Frames are captured once and reused. */
+	const FrameSnapshot&	getSnapshot( int64_t timestamp );
+	//! Returns SDK time between the last two dispatched frames in microseconds, or zero.
+	int64_t				getFrameInterval() const;
+	//! Returns SDK clock time in microseconds.
+	int64_t				now() const;
+	/*! Returns estimator relating the SDK and app clocks. Sampled every 
+		update while connected. Thread-safe to read. */
+	const ClockSync&	getClockSync() const;
 
 	//! Returns true if app is focused for this device.
 	virtual bool		hasFocus() const;
@@ -113,28 +991,204 @@ public:
 	//! Returns true if LEAP application is initialized.
 	virtual bool		isInitialized() const;
 
-	/*! Sets frame event handler. \a eventHandler has the signature \a void(Frame). 
+	//! Returns true while in idle mode.
+	bool				isIdle() const;
+	/*! Enters idle mode after \a seconds of frames without hands. Zero 
+		(the default) disables it. While idle, one frame is delivered per 
+		idle interval and the images policy is suspended. The first frame 
+		with a hand is delivered immediately and ends idle mode. */
+	void				setIdleTimeout( double seconds );
+	double				getIdleTimeout() const;
+	//! Sets time between frames delivered while idle. Default is 0.5 seconds.
+	void				setIdleInterval( double seconds );
+	double				getIdleInterval() const;
+	/*! Emitted on the update thread with true on entering idle mode and 
+		false on leaving it. */
+	ci::signals::Signal<void( bool )>&	getSignalIdle();
+
+	/*! Blocks until the SDK delivers a new frame or \a timeout seconds 
+		pass. Returns the frame, or an invalid frame on timeout or exit. 
+		Woken from the SDK thread, so the frame is not yet returned by 
+		getFrame() or dispatched to update thread handlers. Meant for 
+		worker threads; on the update thread it stalls the app for up 
+		to \a timeout. */
+	Leap::Frame			waitForFrame( double timeout );
+	/*! Blocks until the device is connected or \a timeout seconds pass. 
+		Returns true if connected. Meant for worker threads, as above. */
+	bool				waitForConnection( double timeout );
+
+	/*! Registers \a handler to run on \a executor for each frame which 
+		passes \a filter. Filters run on the thread delivering the frame: 
+		the update thread for EXECUTOR_UPDATE, the SDK thread otherwise. */
+	FrameSubscriptionRef	subscribe( const FrameHandler& handler, FrameExecutor executor = EXECUTOR_UPDATE, 
+									   const FrameFilter& filter = FrameFilter() );
+	/*! Registers \a handler to run as tasks posted to \a executor (eg, a 
+		thread pool). At most one task per subscriber is in flight. */
+	FrameSubscriptionRef	subscribe( const FrameHandler& handler, const TaskExecutor& executor, 
+									   const FrameFilter& filter = FrameFilter() );
+
+	/*! Sets frame event handler. \a eventHandler has the signature \a void(const Frame&). 
 		\a obj is the instance receiving the event. */
 	template<typename T, typename Y> 
 	inline void			connectEventHandler( T eventHandler, Y *obj )
 	{
-		connectEventHandler( std::bind( eventHandler, obj, std::placeholders::_1 ) );
+		connectEventHandler( FrameHandler( [ eventHandler, obj ]( const Leap::Frame& frame )
+		{
+			( obj->*eventHandler )( frame );
+		} ) );
 	}
 	
-	//! Sets frame event callback to \a eventHandler.
-	void				connectEventHandler( const std::function<void( Leap::Frame )>& eventHandler );
+	/*! Sets frame event callback to \a eventHandler, replacing any set 
+		before. Runs on the update thread. */
+	void				connectEventHandler( const FrameHandler& eventHandler );
 	void				disconnectEventHandler();
+
+	/*! Queues \a waiter to be tested against each dispatched frame. 
+		Call on the update thread. */
+	void				addWaiter( FrameWaiter* waiter );
+	//! Dequeues \a waiter without resuming it.
+	void				removeWaiter( FrameWaiter* waiter );
+
+#if defined( LEAPMOTION_COROUTINES )
+	//! Awaits the next dispatched frame.
+	FrameAwaiter		nextFrame();
+	//! Awaits the next completed gesture of \a type. Enable it on the controller first.
+	GestureAwaiter		nextGesture( Leap::Gesture::Type type );
+	//! Awaits the first frame which does not contain the hand with id \a id.
+	HandLostAwaiter		untilHandLost( int32_t id );
+#endif
 protected:
-	Device();
+	typedef std::vector<std::shared_ptr<FrameSubscription::Subscriber>>	SubscriberList;
 
-	std::function<void ( Leap::Frame )>	mEventHandler;
+	Device();
 
+	FrameSubscriptionRef	addSubscriber( const std::shared_ptr<FrameSubscription::Subscriber>& subscriber );
+	bool				admit( const Leap::Frame& frame );
+	const FrameSnapshot&	captureHistory( const Leap::Frame& frame, int64_t keepId );
+	void				dispatch( const Leap::Frame& frame, bool updateThread );
+	//! Returns subscribed fields, or FIELD_ALL if there are none.
+	uint32_t			getCaptureFields() const;
+	//! Rebuilds the subscriber list without disconnected entries, adding \a subscriber if set.
+	void				replaceSubscribers( const std::shared_ptr<FrameSubscription::Subscriber>& subscriber );
 	virtual void		update();
 
+	FrameSubscriptionRef	mEventSubscription;
+	std::shared_ptr<const SubscriberList>	mSubscribers;
+	std::mutex			mSubscribersMutex;
+
+	ClockSync			mClockSync;
+	double				mClockSyncTime;
 	Leap::Controller*	mController;
 	Leap::Device		mDevice;
+	std::shared_ptr<FieldSubscription::Counter>	mFields;
+	Leap::Frame			mFrame;
+	Leap::Frame			mFramePrevious;
+	//! Snapshots of mFramePrevious and mFrame, captured by getSnapshot( timestamp ).
+	FrameSnapshot		mHistory[ 2 ];
+	std::atomic<bool>	mIdle;
+	std::atomic<int64_t>	mIdleInterval;
+	bool				mIdleNotified;
+	std::atomic<int64_t>	mIdleTimeout;
+	int64_t				mIdleTimestamp;
+	InteractionBoxTransform	mInteractionBox;
 	Listener			mListener;
 	std::mutex			mMutex;
+	std::shared_ptr<PolicySubscription::Counter>	mPolicies;
+	FrameSnapshot		mSampled;
+	ScreenCalibration	mScreenCalibration;
+	ci::signals::Signal<void( bool )>	mSignalIdle;
+	FrameSnapshot		mSnapshot;
+	bool				mSnapshotDirty;
+	std::vector<FrameWaiter*>	mWaitersReady;
+	FrameWaiter*		mWaitersHead;
+	FrameWaiter*		mWaitersTail;
+
+	friend class		Listener;
+};
+
+#if defined( LEAPMOTION_COROUTINES )
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Coroutine return type for sequential interaction logic. The 
+	coroutine starts immediately, is resumed by Device::update() and 
+	frees itself when it returns. Awaiters live in the coroutine frame, 
+	so awaiting does not allocate. A coroutine suspended on a device 
+	when the device is destroyed is destroyed without being resumed, 
+	running the destructors of its locals.
+	\code
+	FrameTask MyApp::pinch()
+	{
+		Leap::Frame frame = co_await mDevice->nextFrame();
+		...
+		co_await mDevice->untilHandLost( id );
+	}
+	\endcode */
+struct FrameTask
+{
+	struct promise_type
+	{
+		FrameTask				get_return_object() { return FrameTask(); }
+		std::suspend_never		initial_suspend() noexcept { return std::suspend_never(); }
+		std::suspend_never		final_suspend() noexcept { return std::suspend_never(); }
+		void					return_void() {}
+		void					unhandled_exception() { std::terminate(); }
+	};
+};
+
+//! Resumes on the next dispatched frame.
+class FrameAwaiter : public FrameWaiter
+{
+public:
+	explicit FrameAwaiter( Device* device )
+	: mSource( device ) {}
+	FrameAwaiter( const FrameAwaiter& ) = delete;
+	FrameAwaiter&			operator=( const FrameAwaiter& ) = delete;
+
+	bool					await_ready() const noexcept { return false; }
+	void					await_suspend( std::coroutine_handle<> handle ) { mHandle = handle; mSource->addWaiter( this ); }
+	Leap::Frame				await_resume() const { return mFrame; }
+protected:
+	virtual bool			test( const Leap::Frame& frame ) override { mFrame = frame; return true; }
+	virtual void			resume() override { mHandle.resume(); }
+	virtual void			cancel() override { mHandle.destroy(); }
+
+	Leap::Frame				mFrame;
+	std::coroutine_handle<>	mHandle;
+	Device*					mSource;
 };
 
+//! Resumes on the first frame holding a completed gesture of one type.
+class GestureAwaiter : public FrameAwaiter
+{
+public:
+	GestureAwaiter( Device* device, Leap::Gesture::Type type )
+	: FrameAwaiter( device ), mType( type ) {}
+	GestureAwaiter( const GestureAwaiter& ) = delete;
+	GestureAwaiter&			operator=( const GestureAwaiter& ) = delete;
+
+	Leap::Gesture			await_resume() const { return mGesture; }
+protected:
+	virtual bool			test( const Leap::Frame& frame ) override;
+
+	Leap::Gesture			mGesture;
+	Leap::Gesture::Type		mType;
+};
+
+//! Resumes on the first frame which does not contain the hand with a given id.
+class HandLostAwaiter : public FrameAwaiter
+{
+public:
+	HandLostAwaiter( Device* device, int32_t id )
+	: FrameAwaiter( device ), mId( id ) {}
+	HandLostAwaiter( const HandLostAwaiter& ) = delete;
+	HandLostAwaiter&		operator=( const HandLostAwaiter& ) = delete;
+protected:
+	virtual bool			test( const Leap::Frame& frame ) override;
+
+	int32_t					mId;
+};
+
+#endif
+
 }
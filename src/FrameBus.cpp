@@ -0,0 +1,336 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "FrameBus.h"
+
+#include <cstring>
+
+#if defined( _WIN32 )
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+static const uint32_t kMagic	= 0x4C4D4642; // "LMFB"
+static const uint32_t kVersion	= 1;
+
+struct SharedFrameRing::Header
+{
+	uint32_t				mMagic;
+	uint32_t				mVersion;
+	uint32_t				mCapacity;
+	uint32_t				mSlotSize;
+	std::atomic<uint64_t>	mWriteIndex;
+};
+
+// Sequence is odd while the slot is being written
+struct SharedFrameRing::Slot
+{
+	std::atomic<uint32_t>	mSequence;
+	FrameSnapshot			mFrame;
+};
+
+size_t SharedFrameRing::slotOffset()
+{
+	return ( sizeof( Header ) + 63 ) & ~(size_t)63;
+}
+
+size_t SharedFrameRing::slotStride()
+{
+	return ( sizeof( Slot ) + 63 ) & ~(size_t)63;
+}
+
+SharedFrameRing::SharedFrameRing( const string& name, size_t capacity, bool owner )
+: mHeader( nullptr ), mHandle( nullptr ), mName( name ), mOwner( owner ), mSize( 0 )
+{
+	// The ring is shared through std::atomic members, which only works
+	// across processes if they are lock-free (and so address-free)
+	const atomic<uint64_t> index( 0 );
+	const atomic<uint32_t> sequence( 0 );
+	if ( !index.is_lock_free() || !sequence.is_lock_free() ) {
+		return;
+	}
+
+	// Subscribers never store, but map read/write anyway: atomic loads
+	// may be implemented with exclusive stores, which fault on read-only
+	// pages (eg, 64-bit loads on 32-bit ARM)
+	void* data = nullptr;
+#if defined( _WIN32 )
+	string path = "Local\\" + name;
+	if ( owner ) {
+		mSize			= slotOffset() + slotStride() * capacity;
+		HANDLE handle	= CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			(DWORD)( (uint64_t)mSize >> 32 ), (DWORD)( mSize & 0xFFFFFFFF ), path.c_str() );
+		if ( handle != nullptr ) {
+			mHandle		= handle;
+			data		= MapViewOfFile( handle, FILE_MAP_ALL_ACCESS, 0, 0, mSize );
+		}
+	} else {
+		HANDLE handle	= OpenFileMappingA( FILE_MAP_READ | FILE_MAP_WRITE, FALSE, path.c_str() );
+		if ( handle != nullptr ) {
+			mHandle		= handle;
+			data		= MapViewOfFile( handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 );
+			MEMORY_BASIC_INFORMATION info;
+			if ( data != nullptr && VirtualQuery( data, &info, sizeof( info ) ) != 0 ) {
+				mSize	= info.RegionSize;
+			}
+		}
+	}
+#else
+	string path = "/" + name;
+	if ( owner ) {
+		mSize	= slotOffset() + slotStride() * capacity;
+		shm_unlink( path.c_str() );
+		// Owner only; subscribers must run as the same user
+		int fd	= shm_open( path.c_str(), O_CREAT | O_RDWR, 0600 );
+		if ( fd >= 0 ) {
+			if ( ftruncate( fd, (off_t)mSize ) == 0 ) {
+				data = mmap( nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+			}
+			close( fd );
+		}
+	} else {
+		int fd = shm_open( path.c_str(), O_RDWR, 0 );
+		if ( fd >= 0 ) {
+			struct stat info;
+			if ( fstat( fd, &info ) == 0 && info.st_size > 0 ) {
+				mSize	= (size_t)info.st_size;
+				data	= mmap( nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+			}
+			close( fd );
+		}
+	}
+	if ( data == MAP_FAILED ) {
+		data = nullptr;
+	}
+#endif
+	if ( data == nullptr ) {
+		return;
+	}
+
+	mHeader = (Header*)data;
+	if ( owner ) {
+		memset( data, 0, mSize );
+		mHeader->mCapacity	= (uint32_t)capacity;
+		mHeader->mSlotSize	= (uint32_t)slotStride();
+		mHeader->mVersion	= kVersion;
+		mHeader->mWriteIndex.store( 0, memory_order_relaxed );
+		atomic_thread_fence( memory_order_release );
+		mHeader->mMagic		= kMagic;
+	} else if ( mSize < slotOffset() ||
+				mHeader->mMagic != kMagic ||
+				mHeader->mVersion != kVersion ||
+				mHeader->mSlotSize != slotStride() ||
+				mHeader->mCapacity == 0 ||
+				mSize < slotOffset() + slotStride() * mHeader->mCapacity ) {
+
+		// Not a ring, or written by an incompatible build
+		mHeader = nullptr;
+	}
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+#if defined( _WIN32 )
+	if ( mHeader != nullptr ) {
+		UnmapViewOfFile( mHeader );
+	}
+	if ( mHandle != nullptr ) {
+		CloseHandle( (HANDLE)mHandle );
+	}
+#else
+	if ( mHeader != nullptr ) {
+		munmap( mHeader, mSize );
+	}
+	if ( mOwner ) {
+		shm_unlink( ( "/" + mName ).c_str() );
+	}
+#endif
+}
+
+bool SharedFrameRing::isOpen() const
+{
+	return mHeader != nullptr;
+}
+
+const string& SharedFrameRing::getName() const
+{
+	return mName;
+}
+
+size_t SharedFrameRing::getCapacity() const
+{
+	return mHeader == nullptr ? 0 : mHeader->mCapacity;
+}
+
+uint64_t SharedFrameRing::getWriteIndex() const
+{
+	return mHeader == nullptr ? 0 : mHeader->mWriteIndex.load( memory_order_acquire );
+}
+
+SharedFrameRing::Slot* SharedFrameRing::getSlot( uint64_t index ) const
+{
+	uint8_t* base = (uint8_t*)mHeader + slotOffset();
+	return (Slot*)( base + ( index % mHeader->mCapacity ) * mHeader->mSlotSize );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+FramePublisherRef FramePublisher::create( const string& name, size_t capacity )
+{
+	return FramePublisherRef( new FramePublisher( name, capacity < 2 ? 2 : capacity ) );
+}
+
+FramePublisher::FramePublisher( const string& name, size_t capacity )
+: Leap::Listener(), SharedFrameRing( name, capacity, true )
+{
+}
+
+FramePublisher::~FramePublisher()
+{
+}
+
+void FramePublisher::onFrame( const Leap::Controller& controller )
+{
+	publish( controller.frame() );
+}
+
+void FramePublisher::publish( const Leap::Frame& frame )
+{
+	mSnapshot.capture( frame );
+	publish( mSnapshot );
+}
+
+void FramePublisher::publish( const FrameSnapshot& snapshot )
+{
+	if ( mHeader == nullptr ) {
+		return;
+	}
+
+	uint64_t index	= mHeader->mWriteIndex.load( memory_order_relaxed );
+	Slot* slot		= getSlot( index );
+	uint32_t seq	= slot->mSequence.load( memory_order_relaxed );
+	slot->mSequence.store( seq + 1, memory_order_relaxed );
+	atomic_thread_fence( memory_order_release );
+	memcpy( &slot->mFrame, &snapshot, sizeof( FrameSnapshot ) );
+	slot->mSequence.store( seq + 2, memory_order_release );
+	mHeader->mWriteIndex.store( index + 1, memory_order_release );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+SharedFrameSourceRef SharedFrameSource::create( const string& name )
+{
+	return SharedFrameSourceRef( new SharedFrameSource( name ) );
+}
+
+SharedFrameSource::SharedFrameSource( const string& name )
+: SharedFrameRing( name, 0, false ), mDropped( 0 ), mReadIndex( 0 ), mSlotIndex( 0 )
+{
+	mReadIndex = getWriteIndex();
+}
+
+const FrameSnapshot* SharedFrameSource::acquire( uint32_t& ticket )
+{
+	uint64_t index = getWriteIndex();
+	if ( index == 0 || index == mReadIndex ) {
+		return nullptr;
+	}
+	if ( index - mReadIndex > 1 ) {
+		mDropped += index - mReadIndex - 1;
+	}
+
+	Slot* slot	= getSlot( index - 1 );
+	ticket		= slot->mSequence.load( memory_order_acquire );
+	if ( ( ticket & 1 ) != 0 ) {
+
+		// Writer has lapped the ring and is in this slot
+		return nullptr;
+	}
+	mReadIndex	= index;
+	mSlotIndex	= index - 1;
+	return &slot->mFrame;
+}
+
+bool SharedFrameSource::validate( uint32_t ticket ) const
+{
+	atomic_thread_fence( memory_order_acquire );
+	return getSlot( mSlotIndex )->mSequence.load( memory_order_relaxed ) == ticket;
+}
+
+bool SharedFrameSource::read( FrameSnapshot& snapshot )
+{
+	if ( mHeader == nullptr ) {
+		return false;
+	}
+	for ( size_t attempt = 0; attempt < 16; ++attempt ) {
+		uint32_t ticket				= 0;
+		uint64_t dropped			= mDropped;
+		uint64_t readIndex			= mReadIndex;
+		const FrameSnapshot* frame	= acquire( ticket );
+		if ( frame != nullptr ) {
+			memcpy( &snapshot, frame, sizeof( FrameSnapshot ) );
+			if ( validate( ticket ) ) {
+				return true;
+			}
+		} else if ( getWriteIndex() == mReadIndex ) {
+			return false;
+		}
+
+		// Torn read. Retry against the newest frame.
+		mDropped	= dropped;
+		mReadIndex	= readIndex;
+	}
+	return false;
+}
+
+uint64_t SharedFrameSource::getNumDropped() const
+{
+	return mDropped;
+}
+
+}
@@ -0,0 +1,141 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace LeapMotion {
+
+/*! Shared memory ring of FrameSnapshots. Each slot is guarded by a
+	sequence lock, so one publisher and any number of subscribers in
+	other processes exchange frames without kernel calls or locks. */
+class SharedFrameRing
+{
+public:
+	~SharedFrameRing();
+
+	//! Returns true if the shared memory region is mapped.
+	bool					isOpen() const;
+	//! Returns name of the shared memory region.
+	const std::string&		getName() const;
+	//! Returns number of slots in the ring.
+	size_t					getCapacity() const;
+	//! Returns total number of frames written to the ring.
+	uint64_t				getWriteIndex() const;
+protected:
+	struct Header;
+	struct Slot;
+
+	SharedFrameRing( const std::string& name, size_t capacity, bool owner );
+
+	Slot*					getSlot( uint64_t index ) const;
+	static size_t			slotOffset();
+	static size_t			slotStride();
+
+	Header*					mHeader;
+	void*					mHandle;
+	std::string				mName;
+	bool					mOwner;
+	size_t					mSize;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class FramePublisher> FramePublisherRef;
+
+/*! Publishes every tracking frame into a shared memory ring. Add it
+	to a controller with Leap::Controller::addListener() to publish
+	straight from the SDK thread, or call publish() manually. Remove
+	the listener before releasing the publisher. */
+class FramePublisher : public Leap::Listener, public SharedFrameRing
+{
+public:
+	/*! Creates (or replaces) shared memory region \a name with \a capacity 
+		slots. On POSIX the region has mode 0600, so subscribers must run 
+		as the same user. */
+	static FramePublisherRef	create( const std::string& name = "cinder-leapmotion", size_t capacity = 8 );
+	~FramePublisher();
+
+	//! Captures \a frame and writes it to the ring.
+	void					publish( const Leap::Frame& frame );
+	//! Writes \a snapshot to the ring.
+	void					publish( const FrameSnapshot& snapshot );
+protected:
+	FramePublisher( const std::string& name, size_t capacity );
+
+	virtual void			onFrame( const Leap::Controller& controller );
+
+	FrameSnapshot			mSnapshot;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class SharedFrameSource> SharedFrameSourceRef;
+
+/*! Reads frames published by a FramePublisher in another process.
+	acquire()/validate() read in place without copying. read() makes
+	one copy and retries until it gets a consistent frame. */
+class SharedFrameSource : public SharedFrameRing
+{
+public:
+	//! Opens existing shared memory region \a name.
+	static SharedFrameSourceRef	create( const std::string& name = "cinder-leapmotion" );
+
+	/*! Returns the newest frame in place, or nullptr if nothing newer
+		than the last read has been published. The frame may be
+		overwritten while in use. Call validate() with \a ticket once
+		done; discard any results if it returns false. */
+	const FrameSnapshot*	acquire( uint32_t& ticket );
+	//! Returns true if the frame returned by the last acquire() was not overwritten.
+	bool					validate( uint32_t ticket ) const;
+	//! Copies the newest unread frame into \a snapshot. Returns false if none.
+	bool					read( FrameSnapshot& snapshot );
+
+	//! Returns number of frames skipped because the reader fell behind.
+	uint64_t				getNumDropped() const;
+protected:
+	SharedFrameSource( const std::string& name );
+
+	uint64_t				mDropped;
+	uint64_t				mReadIndex;
+	uint64_t				mSlotIndex;
+};
+
+}
@@ -0,0 +1,468 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "FrameCodec.h"
+#include "ByteStream.h"
+
+#include <cstring>
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+static const uint8_t	kMagic			= 0x4C;
+static const uint8_t	kVersion		= 3;
+
+static const uint8_t	kFlagKeyFrame	= 1 << 0;
+static const uint8_t	kFlagBox		= 1 << 1;
+static const uint8_t	kFlagLeft		= 1 << 0;
+static const uint8_t	kFlagDelta		= 1 << 1;
+
+// Per-hand channel layout. Every channel is one quantized integer.
+static const size_t		kNumPositions	= 4 + 5 * 5;
+static const size_t		kPositions		= 0;
+static const size_t		kUnits			= kPositions + kNumPositions * 3;
+static const size_t		kVelocities		= kUnits + 2 * 3;
+static const size_t		kScalars		= kVelocities + 6 * 3;
+static const size_t		kNumChannels	= kScalars + 12;
+
+static const float		kPositionScale	= 32.0f;
+static const float		kUnitScale		= 32767.0f;
+static const float		kWidthScale		= 10.0f;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+static int32_t quantizeScalar( float v, float scale, int32_t lo, int32_t hi )
+{
+	float q = floorf( v * scale + 0.5f );
+	return q < (float)lo ? lo : q > (float)hi ? hi : (int32_t)q;
+}
+
+// Positions are stored in 1/32 mm steps in device space. The range is 
+// far beyond the tracking volume, so elbows and hands outside the 
+// interaction box are never clamped.
+static void quantizePosition( const vec3& v, int32_t* q )
+{
+	for ( int32_t i = 0; i < 3; ++i ) {
+		q[ i ] = quantizeScalar( v[ i ], kPositionScale, -0x3FFFFFFF, 0x3FFFFFFF );
+	}
+}
+
+static vec3 dequantizePosition( const int32_t* q )
+{
+	return vec3( (float)q[ 0 ], (float)q[ 1 ], (float)q[ 2 ] ) / kPositionScale;
+}
+
+static void quantizeUnit( const vec3& v, int32_t* q )
+{
+	for ( int32_t i = 0; i < 3; ++i ) {
+		q[ i ] = quantizeScalar( v[ i ], kUnitScale, -32767, 32767 );
+	}
+}
+
+static vec3 dequantizeUnit( const int32_t* q )
+{
+	return vec3( (float)q[ 0 ], (float)q[ 1 ], (float)q[ 2 ] ) / kUnitScale;
+}
+
+// Velocities are stored in whole mm/s
+static void quantizeVelocity( const vec3& v, int32_t* q )
+{
+	for ( int32_t i = 0; i < 3; ++i ) {
+		q[ i ] = quantizeScalar( v[ i ], 1.0f, -1000000, 1000000 );
+	}
+}
+
+static vec3 dequantizeVelocity( const int32_t* q )
+{
+	return vec3( (float)q[ 0 ], (float)q[ 1 ], (float)q[ 2 ] );
+}
+
+/*! Builds a basis in the same layout as toMat3( Leap::Matrix ), ie,
+	with the x, y and z axes in rows. z points opposite \a direction
+	and y is as close to \a up as possible. Left hands mirror x. */
+static mat3 toBasis( const vec3& direction, const vec3& up, bool left )
+{
+	vec3 z = -direction;
+	vec3 y = up - z * glm::dot( up, z );
+	float len = glm::length( y );
+	if ( len < 0.00001f ) {
+		y = glm::cross( z, vec3( 1.0f, 0.0f, 0.0f ) );
+		len = glm::length( y );
+	}
+	y /= len;
+	vec3 x = glm::cross( y, z );
+	if ( left ) {
+		x = -x;
+	}
+	return glm::transpose( mat3( x, y, z ) );
+}
+
+static vec3 safeNormalize( const vec3& v, const vec3& fallback )
+{
+	float len = glm::length( v );
+	return len > 0.00001f ? v / len : fallback;
+}
+
+static void quantizeHand( const HandSnapshot& hand, int32_t* q )
+{
+	int32_t* p = q + kPositions;
+	quantizePosition( hand.mPalmPosition,			p + 0 );
+	quantizePosition( hand.mStabilizedPalmPosition,	p + 3 );
+	quantizePosition( hand.mElbowPosition,			p + 6 );
+	quantizePosition( hand.mWristPosition,			p + 9 );
+	p += 12;
+	for ( size_t i = 0; i < 5; ++i ) {
+		const FingerSnapshot& finger = hand.mFingers[ i ];
+		quantizePosition( finger.mBones[ 0 ].mPrevJoint, p );
+		p += 3;
+		for ( size_t j = 0; j < 4; ++j, p += 3 ) {
+			quantizePosition( finger.mBones[ j ].mNextJoint, p );
+		}
+	}
+
+	quantizeUnit( hand.mPalmNormal, q + kUnits + 0 );
+	quantizeUnit( hand.mDirection,	q + kUnits + 3 );
+
+	quantizeVelocity( hand.mPalmVelocity, q + kVelocities );
+	for ( size_t i = 0; i < 5; ++i ) {
+		quantizeVelocity( hand.mFingers[ i ].mTipVelocity, q + kVelocities + 3 + i * 3 );
+	}
+
+	int32_t* s	= q + kScalars;
+	s[ 0 ]		= quantizeScalar( hand.mConfidence,		255.0f, 0, 255 );
+	s[ 1 ]		= quantizeScalar( hand.mGrabStrength,	255.0f, 0, 255 );
+	s[ 2 ]		= quantizeScalar( hand.mPinchStrength,	255.0f, 0, 255 );
+	s[ 3 ]		= quantizeScalar( hand.mPalmWidth,		kWidthScale, 0, 65535 );
+	s[ 4 ]		= quantizeScalar( hand.mArmWidth,		kWidthScale, 0, 65535 );
+	s[ 10 ]		= quantizeScalar( hand.mTimeVisible,	1000.0f, 0, 0x7FFFFFFF );
+	s[ 11 ]		= 0;
+	for ( size_t i = 0; i < 5; ++i ) {
+		s[ 5 + i ] = quantizeScalar( hand.mFingers[ i ].mWidth, kWidthScale, 0, 65535 );
+		if ( hand.mFingers[ i ].mExtended ) {
+			s[ 11 ] |= 1 << i;
+		}
+	}
+}
+
+static void dequantizeHand( const int32_t* q, HandSnapshot& hand )
+{
+	const int32_t* p				= q + kPositions;
+	hand.mPalmPosition				= dequantizePosition( p + 0 );
+	hand.mStabilizedPalmPosition	= dequantizePosition( p + 3 );
+	hand.mElbowPosition				= dequantizePosition( p + 6 );
+	hand.mWristPosition				= dequantizePosition( p + 9 );
+	hand.mPalmNormal				= dequantizeUnit( q + kUnits + 0 );
+	hand.mDirection					= dequantizeUnit( q + kUnits + 3 );
+	hand.mPalmVelocity				= dequantizeVelocity( q + kVelocities );
+
+	const int32_t* s	= q + kScalars;
+	hand.mConfidence	= (float)s[ 0 ] / 255.0f;
+	hand.mGrabStrength	= (float)s[ 1 ] / 255.0f;
+	hand.mPinchStrength	= (float)s[ 2 ] / 255.0f;
+	hand.mPalmWidth		= (float)s[ 3 ] / kWidthScale;
+	hand.mArmWidth		= (float)s[ 4 ] / kWidthScale;
+	hand.mTimeVisible	= (float)s[ 10 ] / 1000.0f;
+
+	vec3 up				= -hand.mPalmNormal;
+	hand.mBasis			= toBasis( hand.mDirection, up, hand.mLeft );
+	hand.mArmBasis		= toBasis( safeNormalize( hand.mWristPosition - hand.mElbowPosition, hand.mDirection ), up, hand.mLeft );
+
+	p += 12;
+	for ( size_t i = 0; i < 5; ++i ) {
+		FingerSnapshot& finger	= hand.mFingers[ i ];
+		finger.mExtended		= ( s[ 11 ] & ( 1 << i ) ) != 0;
+		finger.mId				= hand.mId * 10 + (int32_t)i;
+		finger.mTipVelocity		= dequantizeVelocity( q + kVelocities + 3 + i * 3 );
+		finger.mType			= (int32_t)i;
+		finger.mWidth			= (float)s[ 5 + i ] / kWidthScale;
+
+		vec3 joints[ 5 ];
+		for ( size_t j = 0; j < 5; ++j, p += 3 ) {
+			joints[ j ] = dequantizePosition( p );
+		}
+
+		finger.mLength		= 0.0f;
+		vec3 direction		= hand.mDirection;
+		for ( size_t j = 0; j < 4; ++j ) {
+			BoneSnapshot& bone	= finger.mBones[ j ];
+			bone.mPrevJoint		= joints[ j ];
+			bone.mNextJoint		= joints[ j + 1 ];
+			bone.mWidth			= finger.mWidth;
+			direction			= safeNormalize( bone.mNextJoint - bone.mPrevJoint, direction );
+			bone.mBasis			= toBasis( direction, up, hand.mLeft );
+			if ( j > 0 ) {
+				finger.mLength += glm::distance( bone.mPrevJoint, bone.mNextJoint );
+			}
+		}
+		finger.mDirection	= direction;
+		finger.mTipPosition	= joints[ 4 ];
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameEncoder::FrameEncoder( uint32_t keyFrameInterval )
+: mKeyFrameInterval( keyFrameInterval )
+{
+	reset();
+}
+
+void FrameEncoder::forceKeyFrame()
+{
+	mKeyFrame = true;
+}
+
+uint32_t FrameEncoder::getKeyFrameInterval() const
+{
+	return mKeyFrameInterval;
+}
+
+void FrameEncoder::setKeyFrameInterval( uint32_t v )
+{
+	mKeyFrameInterval = v;
+}
+
+void FrameEncoder::reset()
+{
+	mBoxCenter		= vec3( 0.0f );
+	mBoxSize		= vec3( 0.0f );
+	mFrameCount		= 0;
+	mKeyFrame		= true;
+	mPrevId			= 0;
+	mPrevTimestamp	= 0;
+	mReference.clear();
+}
+
+size_t FrameEncoder::encode( const FrameSnapshot& frame, vector<uint8_t>& buffer )
+{
+	size_t start	= buffer.size();
+	bool key		= mKeyFrame || ( mKeyFrameInterval > 0 && mFrameCount % mKeyFrameInterval == 0 );
+	bool box		= key || frame.mBoxCenter != mBoxCenter || frame.mBoxSize != mBoxSize;
+	mKeyFrame		= false;
+	++mFrameCount;
+
+	buffer.push_back( kMagic );
+	buffer.push_back( kVersion );
+	buffer.push_back( ( key ? kFlagKeyFrame : 0 ) | ( box ? kFlagBox : 0 ) );
+	if ( key ) {
+		writeSigned( buffer, frame.mId );
+		writeSigned( buffer, frame.mTimestamp );
+	} else {
+
+		// Low bits of the reference id let the decoder detect a lost frame
+		writeVarint( buffer, (uint64_t)( mPrevId & 0xFFFF ) );
+		writeSigned( buffer, frame.mId - mPrevId );
+		writeSigned( buffer, frame.mTimestamp - mPrevTimestamp );
+	}
+	writeVarint( buffer, (uint64_t)quantizeScalar( frame.mFramesPerSecond, 100.0f, 0, 0xFFFFFF ) );
+	writeVarint( buffer, frame.mFields );
+	if ( box ) {
+		for ( int32_t i = 0; i < 3; ++i ) {
+			writeFloat( buffer, frame.mBoxCenter[ i ] );
+		}
+		for ( int32_t i = 0; i < 3; ++i ) {
+			writeFloat( buffer, frame.mBoxSize[ i ] );
+		}
+		mBoxCenter	= frame.mBoxCenter;
+		mBoxSize	= frame.mBoxSize;
+	}
+	mPrevId			= frame.mId;
+	mPrevTimestamp	= frame.mTimestamp;
+
+	unordered_map<int32_t, vector<int32_t>> reference;
+	uint32_t numHands = min<uint32_t>( frame.mNumHands, (uint32_t)FrameSnapshot::kMaxHands );
+	buffer.push_back( (uint8_t)numHands );
+	for ( uint32_t i = 0; i < numHands; ++i ) {
+		const HandSnapshot& hand = frame.mHands[ i ];
+		vector<int32_t>& q = reference[ hand.mId ];
+		q.resize( kNumChannels );
+		quantizeHand( hand, &q[ 0 ] );
+
+		unordered_map<int32_t, vector<int32_t>>::const_iterator prev = mReference.find( hand.mId );
+		bool delta = !key && prev != mReference.end();
+
+		writeSigned( buffer, hand.mId );
+		buffer.push_back( ( hand.mLeft ? kFlagLeft : 0 ) | ( delta ? kFlagDelta : 0 ) );
+		for ( size_t j = 0; j < kNumChannels; ++j ) {
+			writeSigned( buffer, delta ? (int64_t)q[ j ] - prev->second[ j ] : q[ j ] );
+		}
+	}
+	mReference.swap( reference );
+
+	uint32_t numGestures = min<uint32_t>( frame.mNumGestures, (uint32_t)FrameSnapshot::kMaxGestures );
+	buffer.push_back( (uint8_t)numGestures );
+	for ( uint32_t i = 0; i < numGestures; ++i ) {
+		const GestureSnapshot& gesture = frame.mGestures[ i ];
+		int32_t q[ 6 ];
+		quantizePosition( gesture.mPosition, q );
+		quantizeUnit( gesture.mDirection, q + 3 );
+
+		writeSigned( buffer, gesture.mId );
+		buffer.push_back( (uint8_t)gesture.mType );
+		buffer.push_back( (uint8_t)gesture.mState );
+		writeSigned( buffer, gesture.mHandId );
+		writeSigned( buffer, gesture.mPointableId );
+		for ( int32_t j = 0; j < 6; ++j ) {
+			writeSigned( buffer, q[ j ] );
+		}
+		writeFloat( buffer, gesture.mProgress );
+		writeVarint( buffer, (uint64_t)quantizeScalar( gesture.mRadius, kWidthScale, 0, 0x7FFFFFFF ) );
+		writeSigned( buffer, gesture.mDuration );
+	}
+
+	return buffer.size() - start;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameDecoder::FrameDecoder()
+{
+	reset();
+}
+
+void FrameDecoder::reset()
+{
+	mBoxCenter		= vec3( 0.0f );
+	mBoxSize		= vec3( 1.0f );
+	mPrevId			= 0;
+	mPrevTimestamp	= 0;
+	mSynced			= false;
+	mReference.clear();
+}
+
+size_t FrameDecoder::decode( const uint8_t* data, size_t size, FrameSnapshot& frame )
+{
+	ByteReader reader( data, size );
+	if ( reader.readByte() != kMagic || reader.readByte() != kVersion ) {
+		return 0;
+	}
+	uint8_t flags	= reader.readByte();
+	bool key		= ( flags & kFlagKeyFrame ) != 0;
+	if ( key ) {
+		frame.mId			= reader.readSigned();
+		frame.mTimestamp	= reader.readSigned();
+	} else {
+		uint64_t ref = reader.readVarint();
+		if ( !mSynced || ref != (uint64_t)( mPrevId & 0xFFFF ) ) {
+			mSynced = false;
+			return 0;
+		}
+		frame.mId			= mPrevId + reader.readSigned();
+		frame.mTimestamp	= mPrevTimestamp + reader.readSigned();
+	}
+	frame.mFramesPerSecond	= (float)reader.readVarint() / 100.0f;
+	frame.mFields			= (uint32_t)reader.readVarint();
+	vec3 center	= mBoxCenter;
+	vec3 extent	= mBoxSize;
+	if ( ( flags & kFlagBox ) != 0 ) {
+		for ( int32_t i = 0; i < 3; ++i ) {
+			center[ i ] = reader.readFloat();
+		}
+		for ( int32_t i = 0; i < 3; ++i ) {
+			extent[ i ] = reader.readFloat();
+		}
+	}
+	frame.mBoxCenter	= center;
+	frame.mBoxSize		= extent;
+
+	unordered_map<int32_t, vector<int32_t>> reference;
+	frame.mNumHands = reader.readByte();
+	if ( frame.mNumHands > FrameSnapshot::kMaxHands ) {
+		return 0;
+	}
+	for ( uint32_t i = 0; i < frame.mNumHands && !reader.hasError(); ++i ) {
+		HandSnapshot& hand	= frame.mHands[ i ];
+		hand.mId			= (int32_t)reader.readSigned();
+		uint8_t handFlags	= reader.readByte();
+		hand.mLeft			= ( handFlags & kFlagLeft ) != 0;
+
+		const int32_t* prev = nullptr;
+		if ( ( handFlags & kFlagDelta ) != 0 ) {
+			unordered_map<int32_t, vector<int32_t>>::const_iterator iter = mReference.find( hand.mId );
+			if ( iter == mReference.end() ) {
+				mSynced = false;
+				return 0;
+			}
+			prev = &iter->second[ 0 ];
+		}
+
+		vector<int32_t>& q = reference[ hand.mId ];
+		q.resize( kNumChannels );
+		for ( size_t j = 0; j < kNumChannels; ++j ) {
+			q[ j ] = (int32_t)( reader.readSigned() + ( prev == nullptr ? 0 : prev[ j ] ) );
+		}
+		dequantizeHand( &q[ 0 ], hand );
+	}
+
+	frame.mNumGestures = reader.readByte();
+	if ( frame.mNumGestures > FrameSnapshot::kMaxGestures ) {
+		return 0;
+	}
+	for ( uint32_t i = 0; i < frame.mNumGestures && !reader.hasError(); ++i ) {
+		GestureSnapshot& gesture	= frame.mGestures[ i ];
+		gesture.mId					= (int32_t)reader.readSigned();
+		gesture.mType				= (int32_t)(int8_t)reader.readByte();
+		gesture.mState				= (int32_t)(int8_t)reader.readByte();
+		gesture.mHandId				= (int32_t)reader.readSigned();
+		gesture.mPointableId		= (int32_t)reader.readSigned();
+		int32_t q[ 6 ];
+		for ( int32_t j = 0; j < 6; ++j ) {
+			q[ j ] = (int32_t)reader.readSigned();
+		}
+		gesture.mPosition			= dequantizePosition( q );
+		gesture.mDirection			= dequantizeUnit( q + 3 );
+		gesture.mProgress			= reader.readFloat();
+		gesture.mRadius				= (float)reader.readVarint() / kWidthScale;
+		gesture.mDuration			= reader.readSigned();
+	}
+
+	if ( reader.hasError() ) {
+		mSynced = false;
+		return 0;
+	}
+
+	mBoxCenter		= center;
+	mBoxSize		= extent;
+	mPrevId			= frame.mId;
+	mPrevTimestamp	= frame.mTimestamp;
+	mSynced			= true;
+	mReference.swap( reference );
+	return reader.getOffset();
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <unordered_map>
+#include <vector>
+
+namespace LeapMotion {
+
+/*! Compact binary frame format. Positions are quantized to 1/32 mm
+	fixed point in device space, so elbows and hands outside the
+	interaction box are not clamped. Unit vectors are quantized to 16
+	bits per axis, and each hand is delta-coded against the previous
+	frame with the same hand id using zig-zag varints. Key frames carry no deltas and let a decoder join
+	or recover mid-stream. Decoding does not need the SDK.
+
+	Bone and arm bases are not sent. The decoder rebuilds them from the
+	joints and palm normal, which matches the SDK to within quantization
+	error for tracked hands. */
+class FrameEncoder
+{
+public:
+	//! A key frame is written every \a keyFrameInterval frames. Zero writes only the first.
+	explicit FrameEncoder( uint32_t keyFrameInterval = 30 );
+
+	/*! Appends encoded \a frame to \a buffer. Returns number of bytes
+		written. */
+	size_t					encode( const FrameSnapshot& frame, std::vector<uint8_t>& buffer );
+	//! Makes next frame a key frame.
+	void					forceKeyFrame();
+	//! Clears all reference state. Next frame is a key frame.
+	void					reset();
+
+	uint32_t				getKeyFrameInterval() const;
+	void					setKeyFrameInterval( uint32_t v );
+protected:
+	ci::vec3				mBoxCenter;
+	ci::vec3				mBoxSize;
+	uint32_t				mFrameCount;
+	bool					mKeyFrame;
+	uint32_t				mKeyFrameInterval;
+	int64_t					mPrevId;
+	int64_t					mPrevTimestamp;
+	std::unordered_map<int32_t, std::vector<int32_t>>	mReference;
+};
+
+//! Decodes frames written by FrameEncoder.
+class FrameDecoder
+{
+public:
+	FrameDecoder();
+
+	/*! Decodes one frame from \a data into \a frame. Returns number of
+		bytes consumed, or zero if the data is malformed or is a delta
+		frame whose reference was not decoded (eg, after packet loss).
+		Decoding resumes at the next key frame. */
+	size_t					decode( const uint8_t* data, size_t size, FrameSnapshot& frame );
+	//! Clears all reference state. Only key frames decode until one arrives.
+	void					reset();
+protected:
+	ci::vec3				mBoxCenter;
+	ci::vec3				mBoxSize;
+	int64_t					mPrevId;
+	int64_t					mPrevTimestamp;
+	bool					mSynced;
+	std::unordered_map<int32_t, std::vector<int32_t>>	mReference;
+};
+
+}
@@ -0,0 +1,856 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "FrameServer.h"
+
+#include <cctype>
+#include <cstring>
+#include <deque>
+
+#if defined( _WIN32 )
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#if defined( _MSC_VER )
+		#pragma comment( lib, "ws2_32.lib" )
+	#endif
+#else
+	#include <arpa/inet.h>
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/select.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+#endif
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+namespace {
+
+const int64_t	kInvalidSocket	= -1;
+const size_t	kMaxInput		= 8192;
+const uint8_t	kOpBinary		= 0x2;
+const uint8_t	kOpClose		= 0x8;
+
+#if defined( _WIN32 )
+typedef SOCKET		SocketHandle;
+typedef int			SocketLength;
+#else
+typedef int			SocketHandle;
+typedef socklen_t	SocketLength;
+#endif
+
+#if defined( MSG_NOSIGNAL )
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+void initSockets()
+{
+#if defined( _WIN32 )
+	WSADATA data;
+	WSAStartup( MAKEWORD( 2, 2 ), &data );
+#endif
+}
+
+void releaseSockets()
+{
+#if defined( _WIN32 )
+	WSACleanup();
+#endif
+}
+
+inline SocketHandle toHandle( int64_t s )
+{
+	return (SocketHandle)s;
+}
+
+int64_t openSocket( int type )
+{
+	SocketHandle s = socket( AF_INET, type, 0 );
+#if defined( _WIN32 )
+	if ( s == INVALID_SOCKET ) {
+		return kInvalidSocket;
+	}
+#else
+	if ( s < 0 ) {
+		return kInvalidSocket;
+	}
+#endif
+	return (int64_t)s;
+}
+
+void closeSocket( int64_t& s )
+{
+	if ( s != kInvalidSocket ) {
+#if defined( _WIN32 )
+		closesocket( toHandle( s ) );
+#else
+		close( toHandle( s ) );
+#endif
+		s = kInvalidSocket;
+	}
+}
+
+bool setNonBlocking( int64_t s )
+{
+#if defined( _WIN32 )
+	u_long mode = 1;
+	return ioctlsocket( toHandle( s ), FIONBIO, &mode ) == 0;
+#else
+	int flags = fcntl( toHandle( s ), F_GETFL, 0 );
+	return flags >= 0 && fcntl( toHandle( s ), F_SETFL, flags | O_NONBLOCK ) == 0;
+#endif
+}
+
+void setOption( int64_t s, int level, int name, int value )
+{
+	setsockopt( toHandle( s ), level, name, (const char*)&value, sizeof( value ) );
+}
+
+// True if the last call failed only because it would have blocked
+bool wouldBlock()
+{
+#if defined( _WIN32 )
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+bool resolve( const string& host, uint16_t port, sockaddr_in& address )
+{
+	addrinfo hints;
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family		= AF_INET;
+	hints.ai_socktype	= SOCK_DGRAM;
+	addrinfo* result	= nullptr;
+	if ( getaddrinfo( host.c_str(), nullptr, &hints, &result ) != 0 || result == nullptr ) {
+		return false;
+	}
+	memcpy( &address, result->ai_addr, sizeof( sockaddr_in ) );
+	address.sin_port = htons( port );
+	freeaddrinfo( result );
+	return true;
+}
+
+uint16_t localPort( int64_t s )
+{
+	sockaddr_in address;
+	SocketLength length = sizeof( address );
+	if ( getsockname( toHandle( s ), (sockaddr*)&address, &length ) != 0 ) {
+		return 0;
+	}
+	return ntohs( address.sin_port );
+}
+
+void writeVarint( vector<uint8_t>& buffer, uint64_t v )
+{
+	while ( v >= 0x80 ) {
+		buffer.push_back( (uint8_t)( v | 0x80 ) );
+		v >>= 7;
+	}
+	buffer.push_back( (uint8_t)v );
+}
+
+bool readVarint( const uint8_t*& data, const uint8_t* end, uint64_t& v )
+{
+	v = 0;
+	for ( uint32_t shift = 0; data < end && shift < 64; shift += 7 ) {
+		uint8_t b	= *data++;
+		v			|= (uint64_t)( b & 0x7F ) << shift;
+		if ( ( b & 0x80 ) == 0 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// SHA-1 and base64, only needed for the WebSocket handshake
+string sha1Base64( const string& text )
+{
+	uint32_t h[ 5 ]		= { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	vector<uint8_t> msg( text.begin(), text.end() );
+	uint64_t bits		= (uint64_t)msg.size() * 8;
+	msg.push_back( 0x80 );
+	while ( msg.size() % 64 != 56 ) {
+		msg.push_back( 0 );
+	}
+	for ( int32_t i = 7; i >= 0; --i ) {
+		msg.push_back( (uint8_t)( bits >> ( i * 8 ) ) );
+	}
+
+	for ( size_t chunk = 0; chunk < msg.size(); chunk += 64 ) {
+		uint32_t w[ 80 ];
+		for ( size_t i = 0; i < 16; ++i ) {
+			const uint8_t* p = &msg[ chunk + i * 4 ];
+			w[ i ] = ( (uint32_t)p[ 0 ] << 24 ) | ( (uint32_t)p[ 1 ] << 16 ) | ( (uint32_t)p[ 2 ] << 8 ) | p[ 3 ];
+		}
+		for ( size_t i = 16; i < 80; ++i ) {
+			uint32_t v	= w[ i - 3 ] ^ w[ i - 8 ] ^ w[ i - 14 ] ^ w[ i - 16 ];
+			w[ i ]		= ( v << 1 ) | ( v >> 31 );
+		}
+		uint32_t a = h[ 0 ], b = h[ 1 ], c = h[ 2 ], d = h[ 3 ], e = h[ 4 ];
+		for ( size_t i = 0; i < 80; ++i ) {
+			uint32_t f;
+			uint32_t k;
+			if ( i < 20 ) {
+				f = ( b & c ) | ( ~b & d );
+				k = 0x5A827999;
+			} else if ( i < 40 ) {
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			} else if ( i < 60 ) {
+				f = ( b & c ) | ( b & d ) | ( c & d );
+				k = 0x8F1BBCDC;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+			uint32_t t	= ( ( a << 5 ) | ( a >> 27 ) ) + f + e + k + w[ i ];
+			e			= d;
+			d			= c;
+			c			= ( b << 30 ) | ( b >> 2 );
+			b			= a;
+			a			= t;
+		}
+		h[ 0 ] += a;
+		h[ 1 ] += b;
+		h[ 2 ] += c;
+		h[ 3 ] += d;
+		h[ 4 ] += e;
+	}
+
+	uint8_t digest[ 21 ] = { 0 };
+	for ( size_t i = 0; i < 20; ++i ) {
+		digest[ i ] = (uint8_t)( h[ i / 4 ] >> ( 24 - ( i % 4 ) * 8 ) );
+	}
+
+	static const char* kTable = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	string result;
+	for ( size_t i = 0; i < 21; i += 3 ) {
+		uint32_t v = ( (uint32_t)digest[ i ] << 16 ) | ( (uint32_t)digest[ i + 1 ] << 8 ) | digest[ i + 2 ];
+		result.push_back( kTable[ ( v >> 18 ) & 0x3F ] );
+		result.push_back( kTable[ ( v >> 12 ) & 0x3F ] );
+		result.push_back( kTable[ ( v >> 6 ) & 0x3F ] );
+		result.push_back( kTable[ v & 0x3F ] );
+	}
+
+	// 20 bytes encode to 27 characters and one pad
+	result[ 27 ] = '=';
+	return result;
+}
+
+// Returns header value, or an empty string if it is missing
+string findHeader( const string& request, const string& name )
+{
+	string lower( request );
+	for ( size_t i = 0; i < lower.size(); ++i ) {
+		lower[ i ] = (char)tolower( (unsigned char)lower[ i ] );
+	}
+	size_t pos = lower.find( "\r\n" + name + ":" );
+	if ( pos == string::npos ) {
+		return "";
+	}
+	pos += name.size() + 3;
+	size_t end = request.find( "\r\n", pos );
+	while ( pos < end && request[ pos ] == ' ' ) {
+		++pos;
+	}
+	while ( end > pos && request[ end - 1 ] == ' ' ) {
+		--end;
+	}
+	return request.substr( pos, end - pos );
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+struct FrameServer::Client
+{
+	Client()
+	: mClosed( false ), mNeedsKeyFrame( true ), mOffset( 0 ), mOpen( false ), mQueueTime( Clock::now() ),
+	mSocket( kInvalidSocket ), mWebSocket( false )
+	{
+		memset( &mAddress, 0, sizeof( mAddress ) );
+	}
+
+	sockaddr_in				mAddress;
+	bool					mClosed;
+	vector<uint8_t>			mInput;
+	bool					mNeedsKeyFrame;
+	size_t					mOffset;
+	bool					mOpen;
+	vector<uint8_t>			mOutput;
+	deque<BufferRef>		mQueue;
+	Clock::time_point		mQueueTime;
+	int64_t					mSocket;
+	bool					mWebSocket;
+};
+
+FrameServer::Options::Options()
+: mFramesPerPacket( 1 ), mKeyFrameInterval( 30 ), mMaxLatency( 0.05 ), mMaxPacketSize( 1400 ),
+mMulticastTtl( 1 ), mQueueSize( 8 ), mWebSocketPort( -1 )
+{
+}
+
+FrameServerRef FrameServer::create( const Options& options )
+{
+	return FrameServerRef( new FrameServer( options ) );
+}
+
+FrameServer::FrameServer( const Options& options )
+: mDropped( 0 ), mEncoder( options.mKeyFrameInterval ), mOptions( options ),
+mRunning( false ), mSocketListen( kInvalidSocket ), mSocketUdp( kInvalidSocket ),
+mSocketWake( kInvalidSocket ), mWebSocketPort( 0 )
+{
+	initSockets();
+	if ( mOptions.mFramesPerPacket < 1 ) {
+		mOptions.mFramesPerPacket = 1;
+	}
+	if ( mOptions.mQueueSize < mOptions.mFramesPerPacket ) {
+		mOptions.mQueueSize = mOptions.mFramesPerPacket;
+	}
+
+	mSocketUdp = openSocket( SOCK_DGRAM );
+	if ( mSocketUdp == kInvalidSocket ) {
+		return;
+	}
+	setNonBlocking( mSocketUdp );
+#if defined( _WIN32 )
+	setOption( mSocketUdp, IPPROTO_IP, IP_MULTICAST_TTL, mOptions.mMulticastTtl );
+#else
+	uint8_t ttl = (uint8_t)mOptions.mMulticastTtl;
+	setsockopt( toHandle( mSocketUdp ), IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof( ttl ) );
+#endif
+
+	// The I/O thread sleeps in select(). A loopback datagram to
+	// ourselves wakes it when frames are queued.
+	sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family		= AF_INET;
+	address.sin_addr.s_addr	= htonl( INADDR_LOOPBACK );
+	mSocketWake				= openSocket( SOCK_DGRAM );
+	if ( mSocketWake == kInvalidSocket ||
+		::bind( toHandle( mSocketWake ), (sockaddr*)&address, sizeof( address ) ) != 0 ) {
+		closeSocket( mSocketWake );
+		closeSocket( mSocketUdp );
+		return;
+	}
+	address.sin_port = htons( localPort( mSocketWake ) );
+	::connect( toHandle( mSocketWake ), (sockaddr*)&address, sizeof( address ) );
+	setNonBlocking( mSocketWake );
+
+	if ( mOptions.mWebSocketPort >= 0 ) {
+		address.sin_addr.s_addr	= htonl( INADDR_ANY );
+		address.sin_port		= htons( (uint16_t)mOptions.mWebSocketPort );
+		mSocketListen			= openSocket( SOCK_STREAM );
+		if ( mSocketListen != kInvalidSocket ) {
+			setOption( mSocketListen, SOL_SOCKET, SO_REUSEADDR, 1 );
+			if ( ::bind( toHandle( mSocketListen ), (sockaddr*)&address, sizeof( address ) ) == 0 &&
+				listen( toHandle( mSocketListen ), 8 ) == 0 ) {
+				setNonBlocking( mSocketListen );
+				mWebSocketPort = localPort( mSocketListen );
+			} else {
+				closeSocket( mSocketListen );
+			}
+		}
+	}
+
+	mRunning	= true;
+	mThread		= thread( &FrameServer::run, this );
+}
+
+FrameServer::~FrameServer()
+{
+	mRunning = false;
+	wake();
+	if ( mThread.joinable() ) {
+		mThread.join();
+	}
+	for ( vector<ClientRef>::iterator iter = mClients.begin(); iter != mClients.end(); ++iter ) {
+		closeSocket( ( *iter )->mSocket );
+	}
+	closeSocket( mSocketListen );
+	closeSocket( mSocketUdp );
+	closeSocket( mSocketWake );
+	releaseSockets();
+}
+
+bool FrameServer::addUdpClient( const string& host, uint16_t port )
+{
+	ClientRef client( new Client() );
+	if ( !resolve( host, port, client->mAddress ) ) {
+		return false;
+	}
+	client->mOpen = true;
+	lock_guard<mutex> lock( mMutex );
+	mClients.push_back( client );
+	return true;
+}
+
+void FrameServer::removeUdpClient( const string& host, uint16_t port )
+{
+	sockaddr_in address;
+	if ( !resolve( host, port, address ) ) {
+		return;
+	}
+	lock_guard<mutex> lock( mMutex );
+	for ( vector<ClientRef>::iterator iter = mClients.begin(); iter != mClients.end(); ) {
+		const Client& client = **iter;
+		if ( !client.mWebSocket &&
+			client.mAddress.sin_addr.s_addr == address.sin_addr.s_addr &&
+			client.mAddress.sin_port == address.sin_port ) {
+			iter = mClients.erase( iter );
+		} else {
+			++iter;
+		}
+	}
+}
+
+void FrameServer::send( const FrameSnapshot& frame )
+{
+	if ( !mRunning ) {
+		return;
+	}
+
+	lock_guard<mutex> lock( mMutex );
+	vector<uint8_t>* delta = new vector<uint8_t>();
+	mEncoder.encode( frame, *delta );
+	BufferRef deltaFrame( delta );
+
+	// Clients which joined late or dropped frames can't decode the
+	// shared delta stream. Give them this frame as a key frame, which
+	// leaves their decoder in the same state as everyone else's.
+	BufferRef keyFrame;
+	const Clock::time_point now = Clock::now();
+	for ( vector<ClientRef>::iterator iter = mClients.begin(); iter != mClients.end(); ++iter ) {
+		Client& client = **iter;
+		if ( !client.mOpen ) {
+			continue;
+		}
+		if ( client.mQueue.size() >= mOptions.mQueueSize ) {
+			mDropped += client.mQueue.size();
+			client.mQueue.clear();
+			client.mNeedsKeyFrame = true;
+		}
+		if ( client.mQueue.empty() ) {
+			client.mQueueTime = now;
+		}
+		if ( client.mNeedsKeyFrame ) {
+			if ( !keyFrame ) {
+				vector<uint8_t>* key = new vector<uint8_t>();
+				mKeyEncoder.forceKeyFrame();
+				mKeyEncoder.encode( frame, *key );
+				keyFrame = BufferRef( key );
+			}
+			client.mQueue.push_back( keyFrame );
+			client.mNeedsKeyFrame = false;
+		} else {
+			client.mQueue.push_back( deltaFrame );
+		}
+	}
+	wake();
+}
+
+size_t FrameServer::getNumClients() const
+{
+	lock_guard<mutex> lock( mMutex );
+	size_t count = 0;
+	for ( vector<ClientRef>::const_iterator iter = mClients.begin(); iter != mClients.end(); ++iter ) {
+		if ( ( *iter )->mOpen ) {
+			++count;
+		}
+	}
+	return count;
+}
+
+uint64_t FrameServer::getNumDropped() const
+{
+	return mDropped;
+}
+
+uint16_t FrameServer::getWebSocketPort() const
+{
+	return mWebSocketPort;
+}
+
+bool FrameServer::isRunning() const
+{
+	return mRunning;
+}
+
+void FrameServer::wake()
+{
+	if ( mSocketWake != kInvalidSocket ) {
+		char b = 0;
+		::send( toHandle( mSocketWake ), &b, 1, 0 );
+	}
+}
+
+double FrameServer::fill( Client& client, const Clock::time_point& now )
+{
+	if ( client.mOffset < client.mOutput.size() || client.mQueue.empty() ) {
+		return mOptions.mMaxLatency;
+	}
+
+	// A part-filled packet waits until its oldest frame is due. Frames
+	// left over from a full packet keep their old time, so go out next.
+	const double wait = mOptions.mMaxLatency - chrono::duration<double>( now - client.mQueueTime ).count();
+	if ( client.mQueue.size() < mOptions.mFramesPerPacket && wait > 0.0 ) {
+		return wait;
+	}
+
+	vector<uint8_t> packet;
+	packet.push_back( 0 );
+	size_t count = 0;
+	while ( !client.mQueue.empty() && count < 255 ) {
+		const vector<uint8_t>& frame = *client.mQueue.front();
+		if ( count > 0 && packet.size() + frame.size() + 3 > mOptions.mMaxPacketSize ) {
+			break;
+		}
+		writeVarint( packet, frame.size() );
+		packet.insert( packet.end(), frame.begin(), frame.end() );
+		client.mQueue.pop_front();
+		++count;
+	}
+	packet[ 0 ] = (uint8_t)count;
+
+	client.mOffset = 0;
+	client.mOutput.clear();
+	if ( client.mWebSocket ) {
+		client.mOutput.push_back( 0x80 | kOpBinary );
+		if ( packet.size() < 126 ) {
+			client.mOutput.push_back( (uint8_t)packet.size() );
+		} else if ( packet.size() < 65536 ) {
+			client.mOutput.push_back( 126 );
+			client.mOutput.push_back( (uint8_t)( packet.size() >> 8 ) );
+			client.mOutput.push_back( (uint8_t)packet.size() );
+		} else {
+			client.mOutput.push_back( 127 );
+			for ( int32_t i = 7; i >= 0; --i ) {
+				client.mOutput.push_back( (uint8_t)( (uint64_t)packet.size() >> ( i * 8 ) ) );
+			}
+		}
+	}
+	client.mOutput.insert( client.mOutput.end(), packet.begin(), packet.end() );
+	return mOptions.mMaxLatency;
+}
+
+void FrameServer::run()
+{
+	vector<ClientRef> clients;
+	vector<uint8_t> buffer( 4096 );
+	while ( mRunning ) {
+		double wait = 0.1;
+		{
+			lock_guard<mutex> lock( mMutex );
+			const Clock::time_point now = Clock::now();
+			clients = mClients;
+			for ( vector<ClientRef>::iterator iter = clients.begin(); iter != clients.end(); ++iter ) {
+				wait = min( wait, fill( **iter, now ) );
+			}
+		}
+
+		fd_set readSet;
+		fd_set writeSet;
+		FD_ZERO( &readSet );
+		FD_ZERO( &writeSet );
+		int64_t maxSocket = mSocketWake;
+		FD_SET( toHandle( mSocketWake ), &readSet );
+		if ( mSocketListen != kInvalidSocket ) {
+			FD_SET( toHandle( mSocketListen ), &readSet );
+			maxSocket = max( maxSocket, mSocketListen );
+		}
+		for ( vector<ClientRef>::iterator iter = clients.begin(); iter != clients.end(); ++iter ) {
+			const Client& client	= **iter;
+			bool pending			= client.mOffset < client.mOutput.size();
+			int64_t s				= client.mWebSocket ? client.mSocket : mSocketUdp;
+			if ( client.mWebSocket ) {
+				FD_SET( toHandle( s ), &readSet );
+			}
+			if ( pending ) {
+				FD_SET( toHandle( s ), &writeSet );
+			}
+			maxSocket = max( maxSocket, s );
+		}
+
+		timeval timeout;
+		timeout.tv_sec	= 0;
+		timeout.tv_usec	= (long)( max( wait, 0.001 ) * 1000000.0 );
+		if ( select( (int)maxSocket + 1, &readSet, &writeSet, nullptr, &timeout ) < 0 ) {
+			continue;
+		}
+
+		if ( FD_ISSET( toHandle( mSocketWake ), &readSet ) ) {
+			while ( recv( toHandle( mSocketWake ), (char*)&buffer[ 0 ], (int)buffer.size(), 0 ) > 0 ) {
+			}
+		}
+
+		if ( mSocketListen != kInvalidSocket && FD_ISSET( toHandle( mSocketListen ), &readSet ) ) {
+			SocketHandle s;
+			while ( ( s = accept( toHandle( mSocketListen ), nullptr, nullptr ) ) != (SocketHandle)kInvalidSocket ) {
+				ClientRef client( new Client() );
+				client->mSocket		= (int64_t)s;
+				client->mWebSocket	= true;
+				setNonBlocking( client->mSocket );
+				setOption( client->mSocket, IPPROTO_TCP, TCP_NODELAY, 1 );
+#if defined( SO_NOSIGPIPE )
+				setOption( client->mSocket, SOL_SOCKET, SO_NOSIGPIPE, 1 );
+#endif
+				lock_guard<mutex> lock( mMutex );
+				mClients.push_back( client );
+			}
+		}
+
+		bool closed = false;
+		for ( vector<ClientRef>::iterator iter = clients.begin(); iter != clients.end(); ++iter ) {
+			Client& client = **iter;
+
+			if ( client.mWebSocket && FD_ISSET( toHandle( client.mSocket ), &readSet ) ) {
+				int received = (int)recv( toHandle( client.mSocket ), (char*)&buffer[ 0 ], (int)buffer.size(), 0 );
+				if ( received > 0 ) {
+					client.mInput.insert( client.mInput.end(), buffer.begin(), buffer.begin() + received );
+				} else if ( received == 0 || !wouldBlock() ) {
+					client.mClosed = true;
+				}
+
+				if ( !client.mOpen && !client.mClosed ) {
+					string request( client.mInput.begin(), client.mInput.end() );
+					if ( request.find( "\r\n\r\n" ) != string::npos ) {
+						string key = findHeader( request, "sec-websocket-key" );
+						if ( key.empty() ) {
+							client.mClosed = true;
+						} else {
+							string response =
+								"HTTP/1.1 101 Switching Protocols\r\n"
+								"Upgrade: websocket\r\n"
+								"Connection: Upgrade\r\n"
+								"Sec-WebSocket-Accept: " + sha1Base64( key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11" ) + "\r\n\r\n";
+							client.mInput.clear();
+							client.mOffset = 0;
+							client.mOutput.assign( response.begin(), response.end() );
+							lock_guard<mutex> lock( mMutex );
+							client.mOpen = true;
+						}
+					} else if ( client.mInput.size() > kMaxInput ) {
+						client.mClosed = true;
+					}
+				}
+
+				// Incoming messages are discarded. Only a close frame matters.
+				while ( client.mOpen && !client.mClosed && client.mInput.size() >= 2 ) {
+					const uint8_t* data	= &client.mInput[ 0 ];
+					uint64_t length		= data[ 1 ] & 0x7F;
+					size_t header		= 2;
+					if ( length == 126 ) {
+						if ( client.mInput.size() < 4 ) {
+							break;
+						}
+						length = ( (uint64_t)data[ 2 ] << 8 ) | data[ 3 ];
+						header = 4;
+					} else if ( length == 127 ) {
+						if ( client.mInput.size() < 10 ) {
+							break;
+						}
+						length = 0;
+						for ( size_t i = 2; i < 10; ++i ) {
+							length = ( length << 8 ) | data[ i ];
+						}
+						header = 10;
+					}
+					if ( ( data[ 1 ] & 0x80 ) != 0 ) {
+						header += 4;
+					}
+					if ( ( data[ 0 ] & 0x0F ) == kOpClose || length > kMaxInput ) {
+						client.mClosed = true;
+					} else if ( client.mInput.size() >= header + length ) {
+						client.mInput.erase( client.mInput.begin(), client.mInput.begin() + ( header + (size_t)length ) );
+					} else {
+						break;
+					}
+				}
+			}
+
+			if ( client.mClosed || client.mOffset >= client.mOutput.size() ) {
+				closed = closed || client.mClosed;
+				continue;
+			}
+			const char* data	= (const char*)&client.mOutput[ client.mOffset ];
+			int size			= (int)( client.mOutput.size() - client.mOffset );
+			if ( client.mWebSocket ) {
+				if ( FD_ISSET( toHandle( client.mSocket ), &writeSet ) ) {
+					int sent = (int)::send( toHandle( client.mSocket ), data, size, kSendFlags );
+					if ( sent > 0 ) {
+						client.mOffset += sent;
+					} else if ( !wouldBlock() ) {
+						client.mClosed	= true;
+						closed			= true;
+					}
+				}
+			} else if ( FD_ISSET( toHandle( mSocketUdp ), &writeSet ) ) {
+				int sent = (int)sendto( toHandle( mSocketUdp ), data, size, 0, (const sockaddr*)&client.mAddress, sizeof( client.mAddress ) );
+				if ( sent >= 0 || !wouldBlock() ) {
+
+					// Datagrams go whole or not at all. Unreachable
+					// hosts lose the packet, not the client.
+					client.mOffset = client.mOutput.size();
+				}
+			}
+		}
+
+		if ( closed ) {
+			lock_guard<mutex> lock( mMutex );
+			for ( vector<ClientRef>::iterator iter = mClients.begin(); iter != mClients.end(); ) {
+				if ( ( *iter )->mClosed ) {
+					closeSocket( ( *iter )->mSocket );
+					iter = mClients.erase( iter );
+				} else {
+					++iter;
+				}
+			}
+		}
+		clients.clear();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameClientRef FrameClient::create( uint16_t port, const string& multicastGroup )
+{
+	return FrameClientRef( new FrameClient( port, multicastGroup ) );
+}
+
+FrameClient::FrameClient( uint16_t port, const string& multicastGroup )
+: mBuffer( 65536 ), mPort( 0 ), mRejected( 0 ), mSocket( kInvalidSocket )
+{
+	initSockets();
+	mSocket = openSocket( SOCK_DGRAM );
+	if ( mSocket == kInvalidSocket ) {
+		return;
+	}
+	setOption( mSocket, SOL_SOCKET, SO_REUSEADDR, 1 );
+
+	sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family		= AF_INET;
+	address.sin_addr.s_addr	= htonl( INADDR_ANY );
+	address.sin_port		= htons( port );
+	if ( ::bind( toHandle( mSocket ), (sockaddr*)&address, sizeof( address ) ) != 0 ) {
+		closeSocket( mSocket );
+		return;
+	}
+	setNonBlocking( mSocket );
+	mPort = localPort( mSocket );
+
+	if ( !multicastGroup.empty() ) {
+		sockaddr_in group;
+		if ( resolve( multicastGroup, mPort, group ) ) {
+			ip_mreq request;
+			request.imr_multiaddr			= group.sin_addr;
+			request.imr_interface.s_addr	= htonl( INADDR_ANY );
+			setsockopt( toHandle( mSocket ), IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&request, sizeof( request ) );
+		}
+	}
+}
+
+FrameClient::~FrameClient()
+{
+	closeSocket( mSocket );
+	releaseSockets();
+}
+
+bool FrameClient::isOpen() const
+{
+	return mSocket != kInvalidSocket;
+}
+
+size_t FrameClient::receive( vector<FrameSnapshot>& frames )
+{
+	if ( mSocket == kInvalidSocket ) {
+		return 0;
+	}
+
+	size_t count = 0;
+	while ( true ) {
+		int received = (int)recv( toHandle( mSocket ), (char*)&mBuffer[ 0 ], (int)mBuffer.size(), 0 );
+		if ( received <= 0 ) {
+			break;
+		}
+
+		const uint8_t* data	= &mBuffer[ 0 ];
+		const uint8_t* end	= data + received;
+		size_t numFrames	= *data++;
+		for ( size_t i = 0; i < numFrames; ++i ) {
+			uint64_t size = 0;
+			if ( !readVarint( data, end, size ) || size > (uint64_t)( end - data ) ) {
+				mRejected += numFrames - i;
+				break;
+			}
+			frames.push_back( FrameSnapshot() );
+			if ( mDecoder.decode( data, (size_t)size, frames.back() ) == 0 ) {
+				frames.pop_back();
+				++mRejected;
+			} else {
+				++count;
+			}
+			data += size;
+		}
+	}
+	return count;
+}
+
+uint64_t FrameClient::getNumRejected() const
+{
+	return mRejected;
+}
+
+uint16_t FrameClient::getPort() const
+{
+	return mPort;
+}
+
+}
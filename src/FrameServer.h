@@ -0,0 +1,188 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "FrameCodec.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LeapMotion {
+
+typedef std::shared_ptr<class FrameServer> FrameServerRef;
+
+/*! Broadcasts frames in FrameEncoder format to UDP destinations
+	(unicast or multicast) and WebSocket clients. All socket work runs
+	on a non-blocking I/O thread. Every client has its own bounded send
+	queue; when a client falls behind its stale frames are dropped and
+	it is resynchronized with a key frame. Pending frames are batched
+	into one datagram or WebSocket message, which is sent once it holds
+	framesPerPacket() frames or its oldest frame is maxLatency() old.
+
+	Packets are a one byte frame count followed by, for each frame, a
+	varint byte length and the encoded frame. */
+class FrameServer
+{
+public:
+	struct Options
+	{
+		Options();
+
+		//! Frames encoded between forced key frames. Bounds UDP loss recovery.
+		Options&		keyFrameInterval( uint32_t v ) { mKeyFrameInterval = v; return *this; }
+		/*! Frames held per client. When a client's queue is full, all of
+			its queued frames are dropped rather than only the oldest:
+			each frame is a delta against the one before, so the client
+			could not decode anything after a gap. It resumes from a key
+			frame instead. */
+		Options&		queueSize( size_t v ) { mQueueSize = v; return *this; }
+		//! Frames to accumulate before a packet is sent. 1 sends every frame immediately.
+		Options&		framesPerPacket( size_t v ) { mFramesPerPacket = v; return *this; }
+		/*! Seconds a frame may wait for a packet to fill before it is sent
+			anyway, so batched frames still go out when tracking stops. */
+		Options&		maxLatency( double v ) { mMaxLatency = v; return *this; }
+		//! Largest datagram in bytes. Frames which would overflow it go in the next packet.
+		Options&		maxPacketSize( size_t v ) { mMaxPacketSize = v; return *this; }
+		//! Multicast TTL. 1 keeps traffic on the local network.
+		Options&		multicastTtl( int32_t v ) { mMulticastTtl = v; return *this; }
+		/*! Port to accept WebSocket clients on. 0 picks a free port
+			(see getWebSocketPort()). -1 disables WebSocket. */
+		Options&		webSocketPort( int32_t v ) { mWebSocketPort = v; return *this; }
+
+		size_t			mFramesPerPacket;
+		uint32_t		mKeyFrameInterval;
+		double			mMaxLatency;
+		size_t			mMaxPacketSize;
+		int32_t			mMulticastTtl;
+		size_t			mQueueSize;
+		int32_t			mWebSocketPort;
+	};
+
+	static FrameServerRef	create( const Options& options = Options() );
+	~FrameServer();
+
+	/*! Adds a UDP destination. \a host may be a unicast or multicast
+		IPv4 address or a host name. Returns false if it cannot be
+		resolved. */
+	bool					addUdpClient( const std::string& host, uint16_t port );
+	//! Removes all UDP destinations matching \a host and \a port.
+	void					removeUdpClient( const std::string& host, uint16_t port );
+
+	/*! Captures and queues \a frame for every client. Inline, so the
+		server links without the SDK when only snapshots are sent. */
+	void					send( const Leap::Frame& frame )
+	{
+		FrameSnapshot snapshot;
+		snapshot.capture( frame );
+		send( snapshot );
+	}
+	//! Encodes and queues \a frame for every client. Thread-safe.
+	void					send( const FrameSnapshot& frame );
+
+	//! Returns number of connected clients (UDP and WebSocket).
+	size_t					getNumClients() const;
+	//! Returns total frames dropped by client queues.
+	uint64_t				getNumDropped() const;
+	//! Returns bound WebSocket port, or zero if disabled.
+	uint16_t				getWebSocketPort() const;
+	//! Returns true if the I/O thread is running.
+	bool					isRunning() const;
+protected:
+	struct Client;
+	typedef std::shared_ptr<Client>						ClientRef;
+	typedef std::shared_ptr<const std::vector<uint8_t>>	BufferRef;
+	typedef std::chrono::steady_clock					Clock;
+
+	FrameServer( const Options& options );
+
+	void					run();
+	//! Builds the client's next packet if it is full or overdue. Returns seconds until it is due.
+	double					fill( Client& client, const Clock::time_point& now );
+	void					wake();
+
+	std::vector<ClientRef>	mClients;
+	std::atomic<uint64_t>	mDropped;
+	FrameEncoder			mEncoder;
+	FrameEncoder			mKeyEncoder;
+	mutable std::mutex		mMutex;
+	Options					mOptions;
+	std::atomic<bool>		mRunning;
+	int64_t					mSocketListen;
+	int64_t					mSocketUdp;
+	int64_t					mSocketWake;
+	std::thread				mThread;
+	uint16_t				mWebSocketPort;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class FrameClient> FrameClientRef;
+
+/*! Receives and decodes FrameServer packets over UDP. Useful for
+	loopback testing and for C++ consumers on other machines. */
+class FrameClient
+{
+public:
+	/*! Binds UDP \a port, or a free port if zero (see getPort()). Joins
+		\a multicastGroup if not empty. */
+	static FrameClientRef	create( uint16_t port, const std::string& multicastGroup = "" );
+	~FrameClient();
+
+	//! Returns true if the socket is bound.
+	bool					isOpen() const;
+	/*! Reads all pending packets without blocking and appends decoded
+		frames to \a frames. Returns number of frames appended. */
+	size_t					receive( std::vector<FrameSnapshot>& frames );
+	//! Returns number of frames which could not be decoded (eg, waiting for a key frame).
+	uint64_t				getNumRejected() const;
+	//! Returns bound port, or zero if the socket is not open.
+	uint16_t				getPort() const;
+protected:
+	FrameClient( uint16_t port, const std::string& multicastGroup );
+
+	std::vector<uint8_t>	mBuffer;
+	FrameDecoder			mDecoder;
+	uint16_t				mPort;
+	uint64_t				mRejected;
+	int64_t					mSocket;
+};
+
+}
@@ -0,0 +1,147 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "HandInstances.h"
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+HandInstances::HandInstances()
+{
+	mBoneRadius		= 2.0f;
+	mDirty			= true;
+	mFrameId		= -1;
+	mJointRadius	= 4.0f;
+
+	// Room for two full hands before the first reallocation
+	mBones.reserve( 64 );
+	mJoints.reserve( 64 );
+}
+
+bool HandInstances::update( const FrameSnapshot& frame )
+{
+	if ( !mDirty && frame.mId == mFrameId ) {
+		return false;
+	}
+	mDirty		= false;
+	mFrameId	= frame.mId;
+
+	mBones.clear();
+	mJoints.clear();
+	for ( uint32_t i = 0; i < frame.mNumHands; ++i ) {
+		addHand( frame.mHands[ i ] );
+	}
+	return true;
+}
+
+void HandInstances::addHand( const HandSnapshot& hand )
+{
+	const vec3& elbow	= hand.mElbowPosition;
+	const vec3& wrist	= hand.mWristPosition;
+	mJoints.push_back( Joint( elbow, mJointRadius ) );
+	mJoints.push_back( Joint( wrist, mJointRadius ) );
+	mBones.push_back( { vec4( elbow, mBoneRadius ), vec4( wrist, mBoneRadius ) } );
+
+	for ( size_t i = 0; i < 5; ++i ) {
+		const FingerSnapshot& finger = hand.mFingers[ i ];
+		for ( size_t j = 0; j < 4; ++j ) {
+			const vec3& start	= finger.mBones[ j ].mPrevJoint;
+			const vec3& end		= finger.mBones[ j ].mNextJoint;
+
+			if ( j == 0 ) {
+				mJoints.push_back( Joint( start, mJointRadius ) );
+				mBones.push_back( { vec4( wrist, mBoneRadius ), vec4( start, mBoneRadius ) } );
+			} else if ( j == 1 && i > 0 ) {
+
+				// Knuckles are joined across the palm
+				const vec3& knuckle = hand.mFingers[ i - 1 ].mBones[ 1 ].mPrevJoint;
+				mBones.push_back( { vec4( knuckle, mBoneRadius ), vec4( start, mBoneRadius ) } );
+			}
+
+			// The thumb's metacarpal has zero length
+			if ( start != end ) {
+				mBones.push_back( { vec4( start, mBoneRadius ), vec4( end, mBoneRadius ) } );
+			}
+			mJoints.push_back( Joint( end, mJointRadius ) );
+		}
+	}
+}
+
+void HandInstances::invalidate()
+{
+	mDirty = true;
+}
+
+const vector<HandInstances::Bone>& HandInstances::getBones() const
+{
+	return mBones;
+}
+
+const vector<HandInstances::Joint>& HandInstances::getJoints() const
+{
+	return mJoints;
+}
+
+int64_t HandInstances::getFrameId() const
+{
+	return mDirty ? -1 : mFrameId;
+}
+
+float HandInstances::getBoneRadius() const
+{
+	return mBoneRadius;
+}
+
+float HandInstances::getJointRadius() const
+{
+	return mJointRadius;
+}
+
+void HandInstances::setBoneRadius( float v )
+{
+	mBoneRadius	= v;
+	mDirty		= true;
+}
+
+void HandInstances::setJointRadius( float v )
+{
+	mJointRadius	= v;
+	mDirty			= true;
+}
+
+}
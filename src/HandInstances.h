@@ -0,0 +1,91 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <vector>
+
+namespace LeapMotion {
+
+/*! CPU stage of HandRenderer: instance data for the joint spheres and 
+	bone cylinders of every hand in a frame. Touches neither GL nor the 
+	SDK, so it can run headless, off the render thread or against 
+	recorded frames. */
+class HandInstances
+{
+public:
+	//! Per-instance cylinder data. xyz is the end point, w is the radius.
+	struct Bone
+	{
+		ci::vec4		mStart;
+		ci::vec4		mEnd;
+	};
+
+	//! Per-instance sphere data. xyz is the center, w is the radius.
+	typedef ci::vec4	Joint;
+
+	HandInstances();
+
+	/*! Rebuilds instances from \a frame, which needs FIELD_ARMS and 
+		FIELD_BONES. Returns false without rebuilding if \a frame has the 
+		same id as the last one and nothing changed since. Existing 
+		capacity is reused. */
+	bool			update( const FrameSnapshot& frame );
+	//! Makes the next update() rebuild, whatever the frame.
+	void			invalidate();
+
+	const std::vector<Bone>&	getBones() const;
+	const std::vector<Joint>&	getJoints() const;
+	//! Returns id of the last frame built, or -1 if none.
+	int64_t			getFrameId() const;
+
+	float			getBoneRadius() const;
+	float			getJointRadius() const;
+	void			setBoneRadius( float v );
+	void			setJointRadius( float v );
+protected:
+	void			addHand( const HandSnapshot& hand );
+
+	float				mBoneRadius;
+	std::vector<Bone>	mBones;
+	bool				mDirty;
+	int64_t				mFrameId;
+	float				mJointRadius;
+	std::vector<Joint>	mJoints;
+};
+
+}
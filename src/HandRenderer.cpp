@@ -0,0 +1,246 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "HandRenderer.h"
+
+#include "Cinder-LeapMotion.h"
+#include "cinder/gl/Batch.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+#include "cinder/GeomIo.h"
+#include <cstddef>
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+static const char* kFragmentShader = CI_GLSL( 150,
+	uniform vec4	uColor;
+
+	in vec3			vNormal;
+
+	out vec4		oColor;
+
+	void main( void )
+	{
+		float d	= abs( normalize( vNormal ).z );
+		oColor	= vec4( uColor.rgb * ( 0.4 + 0.6 * d ), uColor.a );
+	}
+);
+
+// Unit cylinder along +Y is stretched from iStart to iEnd
+static const char* kVertexShaderBone = CI_GLSL( 150,
+	uniform mat4	ciModelViewProjection;
+	uniform mat3	ciNormalMatrix;
+
+	in vec4			ciPosition;
+	in vec3			ciNormal;
+	in vec4			iStart;
+	in vec4			iEnd;
+
+	out vec3		vNormal;
+
+	void main( void )
+	{
+		vec3 axis	= iEnd.xyz - iStart.xyz;
+		float len	= length( axis );
+		vec3 y		= axis / max( len, 0.00001 );
+		vec3 x		= normalize( cross( abs( y.x ) < 0.9 ? vec3( 1.0, 0.0, 0.0 ) : vec3( 0.0, 1.0, 0.0 ), y ) );
+		vec3 z		= cross( x, y );
+		float r		= iStart.w;
+		vec3 p		= iStart.xyz + x * ciPosition.x * r + y * ciPosition.y * len + z * ciPosition.z * r;
+		vNormal		= ciNormalMatrix * ( x * ciNormal.x + y * ciNormal.y + z * ciNormal.z );
+		gl_Position	= ciModelViewProjection * vec4( p, 1.0 );
+	}
+);
+
+// Unit sphere is scaled by iJoint.w and moved to iJoint.xyz
+static const char* kVertexShaderJoint = CI_GLSL( 150,
+	uniform mat4	ciModelViewProjection;
+	uniform mat3	ciNormalMatrix;
+
+	in vec4			ciPosition;
+	in vec3			ciNormal;
+	in vec4			iJoint;
+
+	out vec3		vNormal;
+
+	void main( void )
+	{
+		vNormal		= ciNormalMatrix * ciNormal;
+		gl_Position	= ciModelViewProjection * vec4( iJoint.xyz + ciPosition.xyz * iJoint.w, 1.0 );
+	}
+);
+
+HandRendererRef HandRenderer::create()
+{
+	return HandRendererRef( new HandRenderer() );
+}
+
+HandRenderer::HandRenderer()
+{
+	mColor		= ColorAf( 0.2f, 0.2f, 0.2f, 1.0f );
+
+	// Room for two full hands before the first reallocation
+	mVboBone	= gl::Vbo::create( GL_ARRAY_BUFFER, 64 * sizeof( Bone ), nullptr, GL_DYNAMIC_DRAW );
+	mVboJoint	= gl::Vbo::create( GL_ARRAY_BUFFER, 64 * sizeof( Joint ), nullptr, GL_DYNAMIC_DRAW );
+
+	{
+		gl::VboMeshRef mesh = gl::VboMesh::create( geom::Cylinder()
+			.height( 1.0f ).radius( 1.0f ).origin( vec3( 0.0f ) ).direction( vec3( 0.0f, 1.0f, 0.0f ) )
+			.subdivisionsAxis( 12 ).subdivisionsHeight( 1 ) );
+		geom::BufferLayout layout;
+		layout.append( geom::Attrib::CUSTOM_0, 4, sizeof( Bone ), offsetof( Bone, mStart ), 1 );
+		layout.append( geom::Attrib::CUSTOM_1, 4, sizeof( Bone ), offsetof( Bone, mEnd ), 1 );
+		mesh->appendVbo( layout, mVboBone );
+		gl::GlslProgRef glsl = gl::GlslProg::create( kVertexShaderBone, kFragmentShader );
+		mBatchBone = gl::Batch::create( mesh, glsl, {
+			{ geom::Attrib::CUSTOM_0, "iStart" },
+			{ geom::Attrib::CUSTOM_1, "iEnd" }
+		} );
+	}
+	{
+		gl::VboMeshRef mesh = gl::VboMesh::create( geom::Sphere().radius( 1.0f ).subdivisions( 12 ) );
+		geom::BufferLayout layout;
+		layout.append( geom::Attrib::CUSTOM_0, 4, sizeof( Joint ), 0, 1 );
+		mesh->appendVbo( layout, mVboJoint );
+		gl::GlslProgRef glsl = gl::GlslProg::create( kVertexShaderJoint, kFragmentShader );
+		mBatchJoint = gl::Batch::create( mesh, glsl, { { geom::Attrib::CUSTOM_0, "iJoint" } } );
+	}
+}
+
+void HandRenderer::upload( const gl::VboRef& vbo, const void* data, size_t size )
+{
+	if ( size > vbo->getSize() ) {
+		vbo->bufferData( size, data, GL_DYNAMIC_DRAW );
+	} else {
+
+		// Orphan previous storage so the driver does not stall on last frame's draw
+		vbo->bufferData( vbo->getSize(), nullptr, GL_DYNAMIC_DRAW );
+		vbo->bufferSubData( 0, size, data );
+	}
+}
+
+void HandRenderer::update( const Leap::Frame& frame )
+{
+	// Skip the capture too when the app updates faster than the device
+	if ( frame.isValid() && frame.id() == mInstances.getFrameId() ) {
+		return;
+	}
+	mSnapshot.capture( frame, FIELD_ARMS | FIELD_BONES );
+	update( mSnapshot );
+}
+
+void HandRenderer::update( const FrameSnapshot& frame )
+{
+	if ( mInstances.update( frame ) ) {
+		upload();
+	}
+}
+
+void HandRenderer::upload()
+{
+	const vector<Bone>& bones	= mInstances.getBones();
+	const vector<Joint>& joints	= mInstances.getJoints();
+	if ( !bones.empty() ) {
+		upload( mVboBone, &bones[ 0 ], bones.size() * sizeof( Bone ) );
+	}
+	if ( !joints.empty() ) {
+		upload( mVboJoint, &joints[ 0 ], joints.size() * sizeof( Joint ) );
+	}
+}
+
+void HandRenderer::draw() const
+{
+	const size_t numBones	= mInstances.getBones().size();
+	const size_t numJoints	= mInstances.getJoints().size();
+	if ( numBones > 0 ) {
+		mBatchBone->getGlslProg()->uniform( "uColor", mColor );
+		mBatchBone->drawInstanced( (GLsizei)numBones );
+	}
+	if ( numJoints > 0 ) {
+		mBatchJoint->getGlslProg()->uniform( "uColor", mColor );
+		mBatchJoint->drawInstanced( (GLsizei)numJoints );
+	}
+}
+
+const ColorAf& HandRenderer::getColor() const
+{
+	return mColor;
+}
+
+const HandInstances& HandRenderer::getInstances() const
+{
+	return mInstances;
+}
+
+float HandRenderer::getBoneRadius() const
+{
+	return mInstances.getBoneRadius();
+}
+
+float HandRenderer::getJointRadius() const
+{
+	return mInstances.getJointRadius();
+}
+
+size_t HandRenderer::getNumBones() const
+{
+	return mInstances.getBones().size();
+}
+
+size_t HandRenderer::getNumJoints() const
+{
+	return mInstances.getJoints().size();
+}
+
+void HandRenderer::setColor( const ColorAf& color )
+{
+	mColor = color;
+}
+
+void HandRenderer::setBoneRadius( float v )
+{
+	mInstances.setBoneRadius( v );
+}
+
+void HandRenderer::setJointRadius( float v )
+{
+	mInstances.setJointRadius( v );
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "HandInstances.h"
+#include "cinder/Color.h"
+#include <memory>
+
+// Declared here so including the renderer doesn't pull in GL headers
+namespace cinder { namespace gl {
+typedef std::shared_ptr<class Batch>	BatchRef;
+typedef std::shared_ptr<class Vbo>		VboRef;
+} }
+
+namespace LeapMotion {
+
+typedef std::shared_ptr<class HandRenderer> HandRendererRef;
+
+/*! Draws every hand in a frame as instanced joint spheres and bone
+	cylinders. All hands are drawn with two instanced draw calls. The
+	instance data is built by HandInstances, which can be used alone. */
+class HandRenderer
+{
+public:
+	typedef HandInstances::Bone		Bone;
+	typedef HandInstances::Joint	Joint;
+
+	//! Creates a renderer. Requires a GL context.
+	static HandRendererRef	create();
+
+	/*! Rebuilds instance data from \a frame and uploads it. Does
+		nothing if \a frame was the last one passed in, so it is cheap to
+		call every app update. */
+	void			update( const Leap::Frame& frame );
+	//! Rebuilds from \a frame, which needs FIELD_ARMS and FIELD_BONES. See update( const Leap::Frame& ).
+	void			update( const FrameSnapshot& frame );
+	//! Draws joints and bones from the last update.
+	void			draw() const;
+
+	const ci::ColorAf&	getColor() const;
+	const HandInstances&	getInstances() const;
+	float			getBoneRadius() const;
+	float			getJointRadius() const;
+	size_t			getNumBones() const;
+	size_t			getNumJoints() const;
+	void			setColor( const ci::ColorAf& color );
+	void			setBoneRadius( float v );
+	void			setJointRadius( float v );
+protected:
+	HandRenderer();
+
+	void			upload();
+	void			upload( const ci::gl::VboRef& vbo, const void* data, size_t size );
+
+	ci::gl::BatchRef	mBatchBone;
+	ci::gl::BatchRef	mBatchJoint;
+	HandInstances		mInstances;
+	FrameSnapshot		mSnapshot;
+	ci::gl::VboRef		mVboBone;
+	ci::gl::VboRef		mVboJoint;
+
+	ci::ColorAf			mColor;
+};
+
+}
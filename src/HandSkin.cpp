@@ -0,0 +1,293 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "HandSkin.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+// Fewer vertices than this per thread costs more to wake than it saves
+static const size_t kMinVerticesPerThread = 1024;
+
+// Per joint: four columns of the skinning matrix, then three columns of 
+// its inverse-transpose for normals, as 4-float lanes
+static const size_t kMatrixStride = 28;
+
+HandSkin::Influence::Influence()
+{
+	memset( mJoints, 0, sizeof( mJoints ) );
+	memset( mWeights, 0, sizeof( mWeights ) );
+}
+
+HandSkinRef HandSkin::create( const Mesh& mesh, const HandMatrices& bindPose, size_t numThreads )
+{
+	return HandSkinRef( new HandSkin( mesh, bindPose, numThreads ) );
+}
+
+HandSkin::HandSkin( const Mesh& mesh, const HandMatrices& bindPose, size_t numThreads )
+: mMatrices( nullptr ), mMesh( mesh ), mExiting( false ), mGeneration( 0 ), mPending( 0 )
+{
+	// Normalize weights and drop joints which are out of range
+	mMesh.mInfluences.resize( mMesh.mPositions.size() );
+	for ( vector<Influence>::iterator iter = mMesh.mInfluences.begin(); iter != mMesh.mInfluences.end(); ++iter ) {
+		float sum = 0.0f;
+		for ( size_t i = 0; i < 4; ++i ) {
+			if ( iter->mJoints[ i ] >= HandMatrices::kNumBones || iter->mWeights[ i ] < 0.0f ) {
+				iter->mJoints[ i ]	= 0;
+				iter->mWeights[ i ]	= 0.0f;
+			}
+			sum += iter->mWeights[ i ];
+		}
+		if ( sum > 0.0f ) {
+			for ( size_t i = 0; i < 4; ++i ) {
+				iter->mWeights[ i ] /= sum;
+			}
+		}
+	}
+	if ( mMesh.mNormals.size() != mMesh.mPositions.size() ) {
+		mMesh.mNormals.clear();
+	}
+	mNormals	= mMesh.mNormals;
+	mPositions	= mMesh.mPositions;
+
+	for ( size_t i = 0; i < HandMatrices::kNumBones; ++i ) {
+		mInverseBind[ i ] = glm::inverse( bindPose.mBones[ i ] );
+	}
+
+	mBuffer.resize( HandMatrices::kNumBones * kMatrixStride + 4, 0.0f );
+	uintptr_t address	= (uintptr_t)&mBuffer[ 0 ];
+	mMatrices			= (float*)( ( address + 15 ) & ~(uintptr_t)15 );
+
+	if ( numThreads == 0 ) {
+		numThreads = (size_t)max( thread::hardware_concurrency(), 1u );
+	}
+	numThreads = min( numThreads, max( mPositions.size() / kMinVerticesPerThread, (size_t)1 ) );
+	for ( size_t i = 1; i < numThreads; ++i ) {
+		mThreads.push_back( thread( &HandSkin::run, this, i ) );
+	}
+}
+
+HandSkin::~HandSkin()
+{
+	{
+		lock_guard<mutex> lock( mMutex );
+		mExiting = true;
+	}
+	mCondition.notify_all();
+	for ( vector<thread>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter ) {
+		iter->join();
+	}
+}
+
+size_t HandSkin::getJointIndex( Leap::Finger::Type finger, Leap::Bone::Type bone )
+{
+	return (size_t)finger * 4 + (size_t)bone;
+}
+
+const vector<vec3>& HandSkin::getNormals() const
+{
+	return mNormals;
+}
+
+const vector<vec3>& HandSkin::getPositions() const
+{
+	return mPositions;
+}
+
+size_t HandSkin::getNumThreads() const
+{
+	return mThreads.size() + 1;
+}
+
+void HandSkin::update( const HandMatrices& pose )
+{
+	// Columns of pose * inverse bind, w dropped. Bones are scaled 
+	// non-uniformly, so normals take the inverse-transpose.
+	for ( size_t i = 0; i < HandMatrices::kNumBones; ++i ) {
+		mat4 m		= pose.mBones[ i ] * mInverseBind[ i ];
+		float* v	= mMatrices + i * kMatrixStride;
+		for ( int32_t c = 0; c < 4; ++c ) {
+			v[ c * 4 + 0 ] = m[ c ][ 0 ];
+			v[ c * 4 + 1 ] = m[ c ][ 1 ];
+			v[ c * 4 + 2 ] = m[ c ][ 2 ];
+			v[ c * 4 + 3 ] = 0.0f;
+		}
+		if ( !mNormals.empty() ) {
+			mat3 n = glm::transpose( glm::inverse( mat3( m ) ) );
+			for ( int32_t c = 0; c < 3; ++c ) {
+				v[ 16 + c * 4 + 0 ] = n[ c ][ 0 ];
+				v[ 16 + c * 4 + 1 ] = n[ c ][ 1 ];
+				v[ 16 + c * 4 + 2 ] = n[ c ][ 2 ];
+				v[ 16 + c * 4 + 3 ] = 0.0f;
+			}
+		}
+	}
+
+	if ( mThreads.empty() ) {
+		skin( 0, mPositions.size() );
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock( mMutex );
+		mPending = mThreads.size();
+		++mGeneration;
+	}
+	mCondition.notify_all();
+
+	size_t count = ( mPositions.size() + mThreads.size() ) / ( mThreads.size() + 1 );
+	skin( 0, min( count, mPositions.size() ) );
+
+	unique_lock<mutex> lock( mMutex );
+	mConditionDone.wait( lock, [ this ] { return mPending == 0; } );
+}
+
+void HandSkin::run( size_t index )
+{
+	uint64_t generation = 0;
+	while ( true ) {
+		{
+			unique_lock<mutex> lock( mMutex );
+			mCondition.wait( lock, [ this, generation ] { return mExiting || mGeneration != generation; } );
+			if ( mExiting ) {
+				return;
+			}
+			generation = mGeneration;
+		}
+
+		size_t numThreads	= mThreads.size() + 1;
+		size_t count		= ( mPositions.size() + numThreads - 1 ) / numThreads;
+		size_t begin		= min( index * count, mPositions.size() );
+		skin( begin, min( begin + count, mPositions.size() ) );
+
+		bool done = false;
+		{
+			lock_guard<mutex> lock( mMutex );
+			done = --mPending == 0;
+		}
+		if ( done ) {
+			mConditionDone.notify_one();
+		}
+	}
+}
+
+void HandSkin::skin( size_t begin, size_t end )
+{
+	const Influence* influences	= mMesh.mInfluences.empty() ? nullptr : &mMesh.mInfluences[ 0 ];
+	const vec3* positions		= mMesh.mPositions.empty() ? nullptr : &mMesh.mPositions[ 0 ];
+	const vec3* normals			= mMesh.mNormals.empty() ? nullptr : &mMesh.mNormals[ 0 ];
+	vec3* outPositions			= mPositions.empty() ? nullptr : &mPositions[ 0 ];
+	vec3* outNormals			= mNormals.empty() ? nullptr : &mNormals[ 0 ];
+
+	for ( size_t i = begin; i < end; ++i ) {
+		const Influence& influence = influences[ i ];
+
+#if defined( LEAPMOTION_SSE )
+		__m128 c0 = _mm_setzero_ps();
+		__m128 c1 = _mm_setzero_ps();
+		__m128 c2 = _mm_setzero_ps();
+		__m128 c3 = _mm_setzero_ps();
+		__m128 n0 = _mm_setzero_ps();
+		__m128 n1 = _mm_setzero_ps();
+		__m128 n2 = _mm_setzero_ps();
+		for ( size_t j = 0; j < 4; ++j ) {
+			if ( influence.mWeights[ j ] == 0.0f ) {
+				continue;
+			}
+			const float* m	= mMatrices + influence.mJoints[ j ] * kMatrixStride;
+			__m128 w		= _mm_set1_ps( influence.mWeights[ j ] );
+			c0 = _mm_add_ps( c0, _mm_mul_ps( w, _mm_load_ps( m ) ) );
+			c1 = _mm_add_ps( c1, _mm_mul_ps( w, _mm_load_ps( m + 4 ) ) );
+			c2 = _mm_add_ps( c2, _mm_mul_ps( w, _mm_load_ps( m + 8 ) ) );
+			c3 = _mm_add_ps( c3, _mm_mul_ps( w, _mm_load_ps( m + 12 ) ) );
+			if ( normals != nullptr ) {
+				n0 = _mm_add_ps( n0, _mm_mul_ps( w, _mm_load_ps( m + 16 ) ) );
+				n1 = _mm_add_ps( n1, _mm_mul_ps( w, _mm_load_ps( m + 20 ) ) );
+				n2 = _mm_add_ps( n2, _mm_mul_ps( w, _mm_load_ps( m + 24 ) ) );
+			}
+		}
+
+		float v[ 4 ];
+		const vec3& p	= positions[ i ];
+		__m128 r		= _mm_add_ps( 
+			_mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( p.x ) ), _mm_mul_ps( c1, _mm_set1_ps( p.y ) ) ), 
+			_mm_add_ps( _mm_mul_ps( c2, _mm_set1_ps( p.z ) ), c3 ) );
+		_mm_storeu_ps( v, r );
+		outPositions[ i ] = vec3( v[ 0 ], v[ 1 ], v[ 2 ] );
+
+		if ( normals != nullptr ) {
+			const vec3& n = normals[ i ];
+			r = _mm_add_ps( 
+				_mm_add_ps( _mm_mul_ps( n0, _mm_set1_ps( n.x ) ), _mm_mul_ps( n1, _mm_set1_ps( n.y ) ) ), 
+				_mm_mul_ps( n2, _mm_set1_ps( n.z ) ) );
+			_mm_storeu_ps( v, r );
+			vec3 normal		= vec3( v[ 0 ], v[ 1 ], v[ 2 ] );
+			float length	= glm::length( normal );
+			outNormals[ i ]	= length > 0.0f ? normal / length : n;
+		}
+#else
+		vec3 c[ 7 ];
+		for ( size_t j = 0; j < 4; ++j ) {
+			float w = influence.mWeights[ j ];
+			if ( w == 0.0f ) {
+				continue;
+			}
+			const float* m = mMatrices + influence.mJoints[ j ] * kMatrixStride;
+			for ( size_t k = 0; k < 7; ++k ) {
+				c[ k ] += vec3( m[ k * 4 ], m[ k * 4 + 1 ], m[ k * 4 + 2 ] ) * w;
+			}
+		}
+
+		const vec3& p		= positions[ i ];
+		outPositions[ i ]	= c[ 0 ] * p.x + c[ 1 ] * p.y + c[ 2 ] * p.z + c[ 3 ];
+
+		if ( normals != nullptr ) {
+			const vec3& n	= normals[ i ];
+			vec3 normal		= c[ 4 ] * n.x + c[ 5 ] * n.y + c[ 6 ] * n.z;
+			float length	= glm::length( normal );
+			outNormals[ i ]	= length > 0.0f ? normal / length : n;
+		}
+#endif
+	}
+}
+
+}
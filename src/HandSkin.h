@@ -0,0 +1,117 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LeapMotion {
+
+typedef std::shared_ptr<class HandSkin> HandSkinRef;
+
+/*! CPU linear-blend skinning for a hand mesh rigged to the joints of 
+	HandMatrices. Vertices are split into ranges deformed in parallel 
+	on a small worker pool, four weighted matrices at a time with SSE 
+	where available. Has no GL dependency, so it can run headless 
+	against recorded frames. */
+class HandSkin
+{
+public:
+	//! Up to four joints (HandMatrices indices) per vertex. Unused weights are zero.
+	struct Influence
+	{
+		Influence();
+
+		uint8_t				mJoints[ 4 ];
+		float				mWeights[ 4 ];
+	};
+
+	//! Mesh in bind pose. \a mNormals may be empty.
+	struct Mesh
+	{
+		std::vector<Influence>	mInfluences;
+		std::vector<ci::vec3>	mNormals;
+		std::vector<ci::vec3>	mPositions;
+	};
+
+	/*! Creates skin for \a mesh bound at \a bindPose. Compute \a bindPose 
+		and every later pose with the same computeHandMatrices() scaling. 
+		\a numThreads of zero uses the hardware concurrency. */
+	static HandSkinRef		create( const Mesh& mesh, const HandMatrices& bindPose, size_t numThreads = 0 );
+	~HandSkin();
+
+	//! Returns HandMatrices index of \a bone on \a finger.
+	static size_t			getJointIndex( Leap::Finger::Type finger, Leap::Bone::Type bone );
+
+	//! Deforms the mesh to \a pose. Blocks until all ranges are done.
+	void					update( const HandMatrices& pose );
+
+	//! Returns deformed normals. Empty if the mesh has none.
+	const std::vector<ci::vec3>&	getNormals() const;
+	//! Returns deformed positions.
+	const std::vector<ci::vec3>&	getPositions() const;
+	//! Returns number of threads deforming vertices, including the caller.
+	size_t					getNumThreads() const;
+protected:
+	HandSkin( const Mesh& mesh, const HandMatrices& bindPose, size_t numThreads );
+
+	void					run( size_t index );
+	void					skin( size_t begin, size_t end );
+
+	//! Per joint skinning matrix columns and normal matrix columns as 4-float lanes, 16 byte aligned.
+	std::vector<float>		mBuffer;
+	float*					mMatrices;
+
+	ci::mat4				mInverseBind[ HandMatrices::kNumBones ];
+	Mesh					mMesh;
+	std::vector<ci::vec3>	mNormals;
+	std::vector<ci::vec3>	mPositions;
+
+	std::condition_variable	mCondition;
+	std::condition_variable	mConditionDone;
+	bool					mExiting;
+	uint64_t				mGeneration;
+	std::mutex				mMutex;
+	size_t					mPending;
+	std::vector<std::thread>	mThreads;
+};
+
+}
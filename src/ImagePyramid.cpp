@@ -0,0 +1,307 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "ImagePyramid.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+ImageView::ImageView()
+: mData( nullptr ), mHeight( 0 ), mLevel( 0 ), mOrigin( 0 ), mStride( 0 ), mWidth( 0 )
+{
+}
+
+ImageView::ImageView( const uint8_t* data, int32_t width, int32_t height, int32_t stride )
+: mData( data ), mHeight( height ), mLevel( 0 ), mOrigin( 0 ), mStride( stride ), mWidth( width )
+{
+}
+
+ImageView ImageView::crop( const ivec2& offset, const ivec2& size ) const
+{
+	int32_t x0 = max( offset.x, 0 );
+	int32_t y0 = max( offset.y, 0 );
+	int32_t x1 = min( offset.x + size.x, mWidth );
+	int32_t y1 = min( offset.y + size.y, mHeight );
+
+	ImageView view;
+	view.mLevel = mLevel;
+	if ( x1 > x0 && y1 > y0 ) {
+		view.mData		= mData + (size_t)y0 * mStride + x0;
+		view.mHeight	= y1 - y0;
+		view.mOrigin	= ivec2( mOrigin.x + x0, mOrigin.y + y0 );
+		view.mStride	= mStride;
+		view.mWidth		= x1 - x0;
+	}
+	return view;
+}
+
+bool ImageView::isEmpty() const
+{
+	return mData == nullptr || mWidth <= 0 || mHeight <= 0;
+}
+
+Channel8uRef ImageView::toChannel8u() const
+{
+	Channel8uRef channel;
+	if ( !isEmpty() ) {
+		channel = Channel8u::create( mWidth, mHeight, mStride, sizeof( uint8_t ), (uint8_t*)mData );
+	}
+	return channel;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Averages each 2x2 block of \a src into one pixel of \a dst
+static void downsample( const ImageView& src, uint8_t* dst, int32_t width, int32_t height )
+{
+	for ( int32_t y = 0; y < height; ++y ) {
+		const uint8_t* a	= src.mData + (size_t)( y * 2 ) * src.mStride;
+		const uint8_t* b	= a + src.mStride;
+		uint8_t* d			= dst + (size_t)y * width;
+		int32_t x			= 0;
+#if defined( LEAPMOTION_SSE )
+		const __m128i mask	= _mm_set1_epi16( 0x00FF );
+		const __m128i two	= _mm_set1_epi16( 2 );
+		for ( ; x + 8 <= width; x += 8 ) {
+			__m128i r0	= _mm_loadu_si128( (const __m128i*)( a + x * 2 ) );
+			__m128i r1	= _mm_loadu_si128( (const __m128i*)( b + x * 2 ) );
+			__m128i s	= _mm_add_epi16( 
+				_mm_add_epi16( _mm_and_si128( r0, mask ), _mm_srli_epi16( r0, 8 ) ), 
+				_mm_add_epi16( _mm_and_si128( r1, mask ), _mm_srli_epi16( r1, 8 ) ) );
+			s			= _mm_srli_epi16( _mm_add_epi16( s, two ), 2 );
+			_mm_storel_epi64( (__m128i*)( d + x ), _mm_packus_epi16( s, s ) );
+		}
+#endif
+		for ( ; x < width; ++x ) {
+			d[ x ] = (uint8_t)( ( a[ x * 2 ] + a[ x * 2 + 1 ] + b[ x * 2 ] + b[ x * 2 + 1 ] + 2 ) >> 2 );
+		}
+	}
+}
+
+ImagePyramid::ImagePyramid( size_t numLevels )
+: mNumBuilt( 0 ), mNumLevels( max( numLevels, (size_t)1 ) )
+{
+}
+
+void ImagePyramid::update( const Leap::Image& image )
+{
+	if ( mImage.isValid() && image.isValid() && 
+		 mImage.id() == image.id() && mImage.sequenceId() == image.sequenceId() ) {
+		return;
+	}
+	mImage = image;
+	if ( image.isValid() && image.bytesPerPixel() == 1 ) {
+		reset( ImageView( image.data(), image.width(), image.height(), image.width() ) );
+	} else {
+		reset( ImageView() );
+	}
+}
+
+void ImagePyramid::update( const ImageView& image )
+{
+	mImage = Leap::Image();
+	reset( image );
+}
+
+void ImagePyramid::reset( const ImageView& image )
+{
+	mLevels.clear();
+	mNumBuilt = 0;
+	if ( image.isEmpty() ) {
+		return;
+	}
+
+	// Lay out every level up front so buffers are only reallocated when the size changes
+	mBuffers.resize( mNumLevels );
+	mLevels.push_back( image );
+	mLevels.back().mLevel	= 0;
+	mLevels.back().mOrigin	= ivec2( 0 );
+	mNumBuilt				= 1;
+	int32_t width			= image.mWidth / 2;
+	int32_t height			= image.mHeight / 2;
+	for ( size_t i = 1; i < mNumLevels && width > 0 && height > 0; ++i ) {
+		mBuffers[ i ].resize( (size_t)width * height );
+		ImageView level( &mBuffers[ i ][ 0 ], width, height, width );
+		level.mLevel = (int32_t)i;
+		mLevels.push_back( level );
+		width	/= 2;
+		height	/= 2;
+	}
+}
+
+const ImageView& ImagePyramid::getLevel( size_t level )
+{
+	if ( level >= mLevels.size() ) {
+		return mEmpty;
+	}
+	for ( ; mNumBuilt <= level; ++mNumBuilt ) {
+		const ImageView& view = mLevels[ mNumBuilt ];
+		downsample( mLevels[ mNumBuilt - 1 ], (uint8_t*)view.mData, view.mWidth, view.mHeight );
+	}
+	return mLevels[ level ];
+}
+
+size_t ImagePyramid::getNumLevels() const
+{
+	return mLevels.size();
+}
+
+const Leap::Image& ImagePyramid::getImage() const
+{
+	return mImage;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+HandRegionService::Options::Options()
+: mCameraOffset( 20.0f ), mMargin( 0.5f ), mNumLevels( 4 )
+{
+}
+
+HandRegionServiceRef HandRegionService::create( const Options& options )
+{
+	return HandRegionServiceRef( new HandRegionService( options ) );
+}
+
+HandRegionService::HandRegionService( const Options& options )
+: mOptions( options )
+{
+}
+
+void HandRegionService::update( const Leap::Frame& frame )
+{
+	mRegions.clear();
+
+	const Leap::ImageList& images	= frame.images();
+	const Leap::HandList& hands		= frame.hands();
+	for ( Leap::ImageList::const_iterator imageIter = images.begin(); imageIter != images.end(); ++imageIter ) {
+		const Leap::Image& image = *imageIter;
+		int32_t camera = image.id();
+		if ( !image.isValid() || camera < 0 ) {
+			continue;
+		}
+		while ( (int32_t)mPyramids.size() <= camera ) {
+			mPyramids.push_back( unique_ptr<ImagePyramid>( new ImagePyramid( mOptions.mNumLevels ) ) );
+		}
+		mPyramids[ camera ]->update( image );
+
+		// Ray slopes from this camera, which sits cameraOffset mm left 
+		// (id 0) or right (id 1) of the device center
+		float offset = mOptions.mCameraOffset * (float)( 2 * camera - 1 );
+		for ( Leap::HandList::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
+			const Leap::Hand& hand = *handIter;
+
+			Leap::Vector points[ 8 ];
+			size_t count		= 0;
+			points[ count++ ]	= hand.palmPosition();
+			points[ count++ ]	= hand.wristPosition();
+			const Leap::FingerList& fingers = hand.fingers();
+			for ( Leap::FingerList::const_iterator fingerIter = fingers.begin(); 
+				  fingerIter != fingers.end() && count < 8; ++fingerIter ) {
+				points[ count++ ] = ( *fingerIter ).tipPosition();
+			}
+
+			vec2 minimum( numeric_limits<float>::max() );
+			vec2 maximum( -numeric_limits<float>::max() );
+			float radius = 0.0f;
+			for ( size_t i = 0; i < count; ++i ) {
+				const Leap::Vector& p = points[ i ];
+				if ( p.y <= 0.0f ) {
+					continue;
+				}
+				Leap::Vector pixel = image.warp( Leap::Vector( -( p.x + offset ) / p.y, p.z / p.y, 0.0f ) );
+				minimum = vec2( min( minimum.x, pixel.x ), min( minimum.y, pixel.y ) );
+				maximum = vec2( max( maximum.x, pixel.x ), max( maximum.y, pixel.y ) );
+				if ( i == 0 ) {
+
+					// Palm width in pixels at the palm's depth, from the horizontal scale of the ray
+					Leap::Vector edge = image.warp( Leap::Vector( -( p.x + offset + hand.palmWidth() ) / p.y, p.z / p.y, 0.0f ) );
+					radius = abs( edge.x - pixel.x );
+				}
+			}
+			if ( minimum.x > maximum.x ) {
+				continue;
+			}
+
+			float margin = radius * mOptions.mMargin;
+			Region region;
+			region.mCamera	= camera;
+			region.mHandId	= hand.id();
+			region.mMin		= ivec2( max( (int32_t)floor( minimum.x - margin ), 0 ), 
+									 max( (int32_t)floor( minimum.y - margin ), 0 ) );
+			region.mMax		= ivec2( min( (int32_t)ceil( maximum.x + margin ), image.width() ), 
+									 min( (int32_t)ceil( maximum.y + margin ), image.height() ) );
+			if ( region.mMax.x > region.mMin.x && region.mMax.y > region.mMin.y ) {
+				mRegions.push_back( region );
+			}
+		}
+	}
+}
+
+ImagePyramid* HandRegionService::getPyramid( int32_t camera )
+{
+	if ( camera < 0 || camera >= (int32_t)mPyramids.size() || mPyramids[ camera ]->getNumLevels() == 0 ) {
+		return nullptr;
+	}
+	return mPyramids[ camera ].get();
+}
+
+const vector<HandRegionService::Region>& HandRegionService::getRegions() const
+{
+	return mRegions;
+}
+
+ImageView HandRegionService::getView( const Region& region, size_t level )
+{
+	ImagePyramid* pyramid = getPyramid( region.mCamera );
+	if ( pyramid == nullptr ) {
+		return ImageView();
+	}
+	const ImageView& view	= pyramid->getLevel( level );
+	int32_t scale			= 1 << view.mLevel;
+	ivec2 minimum( region.mMin.x / scale, region.mMin.y / scale );
+	ivec2 maximum( ( region.mMax.x + scale - 1 ) / scale, ( region.mMax.y + scale - 1 ) / scale );
+	return view.crop( minimum, ivec2( maximum.x - minimum.x, maximum.y - minimum.y ) );
+}
+
+}
@@ -0,0 +1,157 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <memory>
+#include <vector>
+
+namespace LeapMotion {
+
+/*! Non-owning view of 8-bit pixels. \a mOrigin is the view's top 
+	left corner within its pyramid level; multiply level coordinates 
+	by 1 << \a mLevel to get full resolution pixels. */
+struct ImageView
+{
+	ImageView();
+	ImageView( const uint8_t* data, int32_t width, int32_t height, int32_t stride );
+
+	//! Returns view of \a size pixels at \a offset, clipped to this view.
+	ImageView			crop( const ci::ivec2& offset, const ci::ivec2& size ) const;
+	//! Returns true if the view has no pixels.
+	bool				isEmpty() const;
+	//! Wraps view in a Channel without copying.
+	ci::Channel8uRef	toChannel8u() const;
+
+	const uint8_t*		mData;
+	int32_t				mHeight;
+	int32_t				mLevel;
+	ci::ivec2			mOrigin;
+	int32_t				mStride;
+	int32_t				mWidth;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Downsampled copies of an image, each half the size of the last 
+	(2x2 box filter, SSE2 where available). Level zero is the source 
+	image itself. Levels are built on first request and kept until 
+	the image changes. */
+class ImagePyramid
+{
+public:
+	ImagePyramid( size_t numLevels = 4 );
+
+	//! Sets source image. Does nothing if \a image is already the source.
+	void				update( const Leap::Image& image );
+	//! Sets source pixels, which must outlive the pyramid's use of them.
+	void				update( const ImageView& image );
+
+	//! Returns \a level, building it if needed. Empty if out of range.
+	const ImageView&	getLevel( size_t level );
+	//! Returns number of levels available for the current image.
+	size_t				getNumLevels() const;
+	//! Returns source image, or an invalid image if fed raw pixels.
+	const Leap::Image&	getImage() const;
+protected:
+	void				reset( const ImageView& image );
+
+	std::vector<std::vector<uint8_t>>	mBuffers;
+	Leap::Image			mImage;
+	std::vector<ImageView>	mLevels;
+	size_t				mNumBuilt;
+	size_t				mNumLevels;
+	ImageView			mEmpty;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class HandRegionService> HandRegionServiceRef;
+
+/*! Keeps an ImagePyramid per camera and finds the region of each 
+	camera image around every tracked hand. Palm, wrist and finger tips 
+	are projected into the image through the camera's distortion 
+	calibration, so vision code can skip empty background. */
+class HandRegionService
+{
+public:
+	//! Bounding box of one hand in one camera image, in full resolution pixels.
+	struct Region
+	{
+		int32_t			mCamera;
+		int32_t			mHandId;
+		ci::ivec2		mMax;
+		ci::ivec2		mMin;
+	};
+
+	struct Options
+	{
+		Options();
+
+		//! Horizontal distance from device center to each camera in millimeters.
+		Options&		cameraOffset( float v ) { mCameraOffset = v; return *this; }
+		//! Padding around the projected hand as a fraction of its palm width.
+		Options&		margin( float v ) { mMargin = v; return *this; }
+		//! Levels per pyramid.
+		Options&		numLevels( size_t v ) { mNumLevels = v; return *this; }
+
+		float			mCameraOffset;
+		float			mMargin;
+		size_t			mNumLevels;
+	};
+
+	static HandRegionServiceRef	create( const Options& options = Options() );
+
+	//! Updates pyramids and regions from \a frame, which must include images.
+	void				update( const Leap::Frame& frame );
+
+	//! Returns pyramid for \a camera, or nullptr if it had no image.
+	ImagePyramid*		getPyramid( int32_t camera );
+	//! Returns hand regions from the latest frame.
+	const std::vector<Region>&	getRegions() const;
+	//! Returns view of \a region at pyramid \a level without copying.
+	ImageView			getView( const Region& region, size_t level = 0 );
+protected:
+	HandRegionService( const Options& options );
+
+	Options				mOptions;
+	//! Indexed by camera. Levels point into their pyramid, so pyramids never move.
+	std::vector<std::unique_ptr<ImagePyramid>>	mPyramids;
+	std::vector<Region>	mRegions;
+};
+
+}
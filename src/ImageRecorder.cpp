@@ -0,0 +1,712 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "ImageRecorder.h"
+#include "ByteStream.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+static const uint32_t	kFileMagic		= 0x52494D4C; // "LMIR"
+static const uint32_t	kIndexMagic		= 0x58494D4C; // "LMIX"
+static const uint32_t	kRecordMagic	= 0x46494D4C; // "LMIF"
+static const uint32_t	kVersion		= 1;
+
+static const uint8_t	kPredictSpatial	= 0;
+static const uint8_t	kPredictPrevious	= 1;
+
+static const uint32_t	kProbBits		= 12;
+static const uint32_t	kProbScale		= 1 << kProbBits;
+static const uint32_t	kRansLow		= 1 << 23;
+
+// Header and footer fields are fixed width, everything else is varints
+static const size_t		kFileHeaderSize	= 8;
+static const size_t		kFooterSize		= 16;
+static const size_t		kRecordHeaderSize	= 8;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeFixed( uint8_t* data, uint64_t v, size_t size )
+{
+	for ( size_t i = 0; i < size; ++i ) {
+		data[ i ] = (uint8_t)( v >> ( i * 8 ) );
+	}
+}
+
+static uint64_t readFixed( const uint8_t* data, size_t size )
+{
+	uint64_t v = 0;
+	for ( size_t i = 0; i < size; ++i ) {
+		v |= (uint64_t)data[ i ] << ( i * 8 );
+	}
+	return v;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// LOCO-I median edge detector from left ( a ), above ( b ) and above left ( c )
+static inline uint8_t predictMed( int32_t a, int32_t b, int32_t c )
+{
+	int32_t lo = min( a, b );
+	int32_t hi = max( a, b );
+	return (uint8_t)( c >= hi ? lo : ( c <= lo ? hi : a + b - c ) );
+}
+
+// Row 0 predicts from the left, column 0 from above, everything else by median
+static void predictSpatial( const uint8_t* src, int32_t width, int32_t height, uint8_t* residuals )
+{
+	residuals[ 0 ] = src[ 0 ];
+	for ( int32_t x = 1; x < width; ++x ) {
+		residuals[ x ] = (uint8_t)( src[ x ] - src[ x - 1 ] );
+	}
+	for ( int32_t y = 1; y < height; ++y ) {
+		const uint8_t* row		= src + (size_t)y * width;
+		const uint8_t* above	= row - width;
+		uint8_t* out			= residuals + (size_t)y * width;
+		out[ 0 ]	= (uint8_t)( row[ 0 ] - above[ 0 ] );
+		int32_t x	= 1;
+#if defined( LEAPMOTION_SSE )
+
+		// Inputs are all source pixels, so 16 predictions go at once. 
+		// a + b - c only wraps when it isn't selected.
+		for ( ; x + 16 <= width; x += 16 ) {
+			__m128i a		= _mm_loadu_si128( (const __m128i*)( row + x - 1 ) );
+			__m128i b		= _mm_loadu_si128( (const __m128i*)( above + x ) );
+			__m128i c		= _mm_loadu_si128( (const __m128i*)( above + x - 1 ) );
+			__m128i lo		= _mm_min_epu8( a, b );
+			__m128i hi		= _mm_max_epu8( a, b );
+			__m128i grad	= _mm_sub_epi8( _mm_add_epi8( a, b ), c );
+			__m128i aboveHi	= _mm_cmpeq_epi8( _mm_max_epu8( c, hi ), c );
+			__m128i belowLo	= _mm_andnot_si128( aboveHi, _mm_cmpeq_epi8( _mm_min_epu8( c, lo ), c ) );
+			__m128i middle	= _mm_andnot_si128( _mm_or_si128( aboveHi, belowLo ), grad );
+			__m128i pred	= _mm_or_si128( _mm_or_si128( _mm_and_si128( aboveHi, lo ), _mm_and_si128( belowLo, hi ) ), middle );
+			_mm_storeu_si128( (__m128i*)( out + x ), _mm_sub_epi8( _mm_loadu_si128( (const __m128i*)( row + x ) ), pred ) );
+		}
+#endif
+		for ( ; x < width; ++x ) {
+			out[ x ] = (uint8_t)( row[ x ] - predictMed( row[ x - 1 ], above[ x ], above[ x - 1 ] ) );
+		}
+	}
+}
+
+static void unpredictSpatial( const uint8_t* residuals, int32_t width, int32_t height, uint8_t* dst )
+{
+	dst[ 0 ] = residuals[ 0 ];
+	for ( int32_t x = 1; x < width; ++x ) {
+		dst[ x ] = (uint8_t)( residuals[ x ] + dst[ x - 1 ] );
+	}
+	for ( int32_t y = 1; y < height; ++y ) {
+		const uint8_t* in		= residuals + (size_t)y * width;
+		uint8_t* row			= dst + (size_t)y * width;
+		const uint8_t* above	= row - width;
+		row[ 0 ] = (uint8_t)( in[ 0 ] + above[ 0 ] );
+		for ( int32_t x = 1; x < width; ++x ) {
+			row[ x ] = (uint8_t)( in[ x ] + predictMed( row[ x - 1 ], above[ x ], above[ x - 1 ] ) );
+		}
+	}
+}
+
+// Sum of absolute residuals on every eighth row, to pick a predictor
+static uint64_t estimateCost( const uint8_t* src, const uint8_t* prev, int32_t width, int32_t height )
+{
+	uint64_t cost = 0;
+	for ( int32_t y = 1; y < height; y += 8 ) {
+		const uint8_t* row = src + (size_t)y * width;
+		for ( int32_t x = 1; x < width; ++x ) {
+			uint8_t p	= prev == nullptr ? predictMed( row[ x - 1 ], row[ x - width ], row[ x - width - 1 ] ) : prev[ (size_t)y * width + x ];
+			cost		+= (uint64_t)abs( (int32_t)(int8_t)( row[ x ] - p ) );
+		}
+	}
+	return cost;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Scales symbol counts to sum to kProbScale, keeping every used symbol codable
+static void normalizeFrequencies( const uint32_t* counts, size_t total, uint32_t* freqs )
+{
+	uint32_t sum		= 0;
+	size_t largest		= 0;
+	for ( size_t i = 0; i < 256; ++i ) {
+		freqs[ i ] = 0;
+		if ( counts[ i ] > 0 ) {
+			freqs[ i ] = max( (uint32_t)( (uint64_t)counts[ i ] * kProbScale / total ), 1u );
+		}
+		sum += freqs[ i ];
+		if ( counts[ i ] > counts[ largest ] ) {
+			largest = i;
+		}
+	}
+	while ( sum > kProbScale ) {
+		size_t i = (size_t)( max_element( freqs, freqs + 256 ) - freqs );
+		--freqs[ i ];
+		--sum;
+	}
+	freqs[ largest ] += kProbScale - sum;
+}
+
+static void encodeRans( const uint8_t* data, size_t size, vector<uint8_t>& scratch, vector<uint8_t>& buffer )
+{
+	uint32_t counts[ 256 ] = { 0 };
+	for ( size_t i = 0; i < size; ++i ) {
+		++counts[ data[ i ] ];
+	}
+	uint32_t freqs[ 256 ];
+	uint32_t starts[ 256 ];
+	normalizeFrequencies( counts, max( size, (size_t)1 ), freqs );
+	uint32_t start = 0;
+	for ( size_t i = 0; i < 256; ++i ) {
+		starts[ i ] = start;
+		start		+= freqs[ i ];
+		writeVarint( buffer, freqs[ i ] );
+	}
+
+	// Symbols are coded last to first so they decode in order. A 
+	// symbol costs at most kProbBits bits.
+	scratch.resize( size + size / 2 + 16 );
+	uint8_t* end	= &scratch[ 0 ] + scratch.size();
+	uint8_t* ptr	= end;
+	uint32_t x		= kRansLow;
+	for ( size_t i = size; i > 0; --i ) {
+		uint8_t s		= data[ i - 1 ];
+		uint32_t freq	= freqs[ s ];
+		uint32_t xMax	= ( ( kRansLow >> kProbBits ) << 8 ) * freq;
+		while ( x >= xMax ) {
+			*--ptr	= (uint8_t)x;
+			x		>>= 8;
+		}
+		x = ( ( x / freq ) << kProbBits ) + ( x % freq ) + starts[ s ];
+	}
+	ptr -= 4;
+	writeFixed( ptr, x, 4 );
+
+	writeVarint( buffer, (uint64_t)( end - ptr ) );
+	buffer.insert( buffer.end(), ptr, end );
+}
+
+static bool decodeRans( ByteReader& reader, uint8_t* out, size_t size )
+{
+	uint32_t freqs[ 256 ];
+	uint32_t starts[ 256 ];
+	uint32_t start = 0;
+	for ( size_t i = 0; i < 256; ++i ) {
+
+		// Checked before the cast and sum, so a huge value can't wrap 
+		// start and overrun the symbol table
+		uint64_t freq = reader.readVarint();
+		if ( freq > kProbScale - start ) {
+			return false;
+		}
+		freqs[ i ]	= (uint32_t)freq;
+		starts[ i ]	= start;
+		start		+= freqs[ i ];
+	}
+	if ( start != kProbScale ) {
+		return false;
+	}
+	uint8_t symbols[ kProbScale ];
+	for ( size_t i = 0; i < 256; ++i ) {
+		memset( symbols + starts[ i ], (int32_t)i, freqs[ i ] );
+	}
+
+	size_t length			= (size_t)reader.readVarint();
+	const uint8_t* ptr		= reader.readBytes( length );
+	if ( reader.hasError() || length < 4 ) {
+		return false;
+	}
+	const uint8_t* end	= ptr + length;
+	uint32_t x			= (uint32_t)readFixed( ptr, 4 );
+	ptr					+= 4;
+	for ( size_t i = 0; i < size; ++i ) {
+		uint32_t slot	= x & ( kProbScale - 1 );
+		uint8_t s		= symbols[ slot ];
+		out[ i ]		= s;
+		x				= freqs[ s ] * ( x >> kProbBits ) + slot - starts[ s ];
+		while ( x < kRansLow ) {
+			if ( ptr >= end ) {
+				return false;
+			}
+			x = ( x << 8 ) | *ptr++;
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+RecordedImages::RecordedImages()
+: mFrameId( 0 ), mSequenceId( 0 ), mTimestamp( 0 )
+{
+}
+
+RecordedImages::Camera::Camera()
+: mHeight( 0 ), mId( 0 ), mWidth( 0 )
+{
+}
+
+ImageView RecordedImages::Camera::getView() const
+{
+	if ( mData.empty() ) {
+		return ImageView();
+	}
+	return ImageView( &mData[ 0 ], mWidth, mHeight, mWidth );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+struct ImageRecorder::Entry
+{
+	int64_t		mFrameId;
+	bool		mKey;
+	uint64_t	mOffset;
+	int64_t		mSequenceId;
+};
+
+ImageRecorderRef ImageRecorder::create( const string& path, uint32_t keyFrameInterval, size_t queueSize )
+{
+	return ImageRecorderRef( new ImageRecorder( path, keyFrameInterval, max( queueSize, (size_t)1 ) ) );
+}
+
+ImageRecorder::ImageRecorder( const string& path, uint32_t keyFrameInterval, size_t queueSize )
+: mDropped( 0 ), mExiting( false ), mFrames( 0 ), mKeyFrameInterval( keyFrameInterval ), 
+mQueueSize( queueSize )
+{
+	mFile.open( path.c_str(), ios::binary | ios::out | ios::trunc );
+	if ( mFile.is_open() ) {
+		uint8_t header[ kFileHeaderSize ];
+		writeFixed( header, kFileMagic, 4 );
+		writeFixed( header + 4, kVersion, 4 );
+		mFile.write( (const char*)header, kFileHeaderSize );
+		mThread = thread( &ImageRecorder::run, this );
+	}
+}
+
+ImageRecorder::~ImageRecorder()
+{
+	if ( !mThread.joinable() ) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock( mMutex );
+		mExiting = true;
+	}
+	mCondition.notify_one();
+	mThread.join();
+
+	// Seek index goes last so recording never has to rewrite the file
+	uint64_t offset = (uint64_t)mFile.tellp();
+	mBuffer.clear();
+	for ( vector<Entry>::const_iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter ) {
+		mBuffer.push_back( iter->mKey ? 1 : 0 );
+		writeSigned( mBuffer, iter->mSequenceId );
+		writeSigned( mBuffer, iter->mFrameId );
+		writeVarint( mBuffer, iter->mOffset );
+	}
+	size_t size = mBuffer.size();
+	mBuffer.resize( size + kFooterSize );
+	writeFixed( &mBuffer[ size ], offset, 8 );
+	writeFixed( &mBuffer[ size + 8 ], mEntries.size(), 4 );
+	writeFixed( &mBuffer[ size + 12 ], kIndexMagic, 4 );
+	mFile.write( (const char*)&mBuffer[ 0 ], mBuffer.size() );
+	mFile.close();
+}
+
+bool ImageRecorder::isOpen() const
+{
+	return mThread.joinable();
+}
+
+uint64_t ImageRecorder::getNumDropped() const
+{
+	return mDropped;
+}
+
+uint64_t ImageRecorder::getNumFrames() const
+{
+	return mFrames;
+}
+
+void ImageRecorder::record( const Leap::Frame& frame )
+{
+	if ( !mThread.joinable() || frame.images().isEmpty() ) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock( mMutex );
+		if ( mQueue.size() >= mQueueSize ) {
+			++mDropped;
+			return;
+		}
+		mQueue.push_back( frame );
+	}
+	mCondition.notify_one();
+}
+
+void ImageRecorder::run()
+{
+	while ( true ) {
+		Leap::Frame frame;
+		{
+			unique_lock<mutex> lock( mMutex );
+			mCondition.wait( lock, [ this ]()
+			{
+				return mExiting || !mQueue.empty();
+			} );
+			if ( mQueue.empty() ) {
+				return;
+			}
+			frame = mQueue.front();
+			mQueue.pop_front();
+		}
+		write( frame );
+	}
+}
+
+void ImageRecorder::write( const Leap::Frame& frame )
+{
+	vector<Leap::Image> images;
+	const Leap::ImageList& imageList = frame.images();
+	for ( Leap::ImageList::const_iterator iter = imageList.begin(); iter != imageList.end(); ++iter ) {
+		const Leap::Image& image = *iter;
+		if ( image.isValid() && image.bytesPerPixel() == 1 && image.width() > 0 && image.height() > 0 ) {
+			images.push_back( image );
+		}
+	}
+	if ( images.empty() ) {
+		return;
+	}
+
+	uint64_t count	= mFrames;
+	bool key		= count == 0 || ( mKeyFrameInterval > 0 && count % mKeyFrameInterval == 0 );
+
+	Entry entry;
+	entry.mFrameId		= frame.id();
+	entry.mKey			= key;
+	entry.mOffset		= (uint64_t)mFile.tellp();
+	entry.mSequenceId	= images.front().sequenceId();
+
+	mBuffer.assign( kRecordHeaderSize, 0 );
+	mBuffer.push_back( key ? 1 : 0 );
+	writeSigned( mBuffer, entry.mFrameId );
+	writeSigned( mBuffer, frame.timestamp() );
+	writeSigned( mBuffer, entry.mSequenceId );
+	writeVarint( mBuffer, images.size() );
+
+	vector<uint8_t> scratch;
+	for ( vector<Leap::Image>::const_iterator iter = images.begin(); iter != images.end(); ++iter ) {
+		const uint8_t* data	= iter->data();
+		int32_t id			= iter->id();
+		int32_t height		= iter->height();
+		int32_t width		= iter->width();
+		size_t size			= (size_t)width * height;
+
+		RecordedImages::Camera* reference = nullptr;
+		for ( vector<RecordedImages::Camera>::iterator ref = mReference.begin(); ref != mReference.end(); ++ref ) {
+			if ( ref->mId == id ) {
+				reference = &*ref;
+			}
+		}
+		if ( reference == nullptr ) {
+			mReference.push_back( RecordedImages::Camera() );
+			reference		= &mReference.back();
+			reference->mId	= id;
+		}
+		bool temporal = !key && reference->mWidth == width && reference->mHeight == height && 
+			estimateCost( data, &reference->mData[ 0 ], width, height ) < estimateCost( data, nullptr, width, height );
+
+		mResiduals.resize( size );
+		if ( temporal ) {
+			const uint8_t* prev = &reference->mData[ 0 ];
+			for ( size_t i = 0; i < size; ++i ) {
+				mResiduals[ i ] = (uint8_t)( data[ i ] - prev[ i ] );
+			}
+		} else {
+			predictSpatial( data, width, height, &mResiduals[ 0 ] );
+		}
+
+		writeSigned( mBuffer, id );
+		writeVarint( mBuffer, (uint64_t)width );
+		writeVarint( mBuffer, (uint64_t)height );
+		mBuffer.push_back( temporal ? kPredictPrevious : kPredictSpatial );
+		encodeRans( &mResiduals[ 0 ], size, scratch, mBuffer );
+
+		reference->mData.assign( data, data + size );
+		reference->mHeight	= height;
+		reference->mWidth	= width;
+	}
+
+	writeFixed( &mBuffer[ 0 ], kRecordMagic, 4 );
+	writeFixed( &mBuffer[ 4 ], mBuffer.size() - kRecordHeaderSize, 4 );
+	mFile.write( (const char*)&mBuffer[ 0 ], mBuffer.size() );
+	mEntries.push_back( entry );
+	++mFrames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+struct ImageReader::Entry
+{
+	int64_t		mFrameId;
+	bool		mKey;
+	uint64_t	mOffset;
+	int64_t		mSequenceId;
+};
+
+ImageReaderRef ImageReader::create( const string& path )
+{
+	return ImageReaderRef( new ImageReader( path ) );
+}
+
+ImageReader::ImageReader( const string& path )
+: mNext( 0 ), mReferenceIndex( -1 )
+{
+	mFile.open( path.c_str(), ios::binary | ios::in );
+	uint8_t header[ kFileHeaderSize ];
+	if ( !mFile.read( (char*)header, kFileHeaderSize ) || 
+		 readFixed( header, 4 ) != kFileMagic || readFixed( header + 4, 4 ) != kVersion ) {
+		mFile.close();
+		return;
+	}
+
+	// Read the index from the footer, or rebuild it if recording was cut short
+	mFile.seekg( 0, ios::end );
+	uint64_t fileSize = (uint64_t)mFile.tellg();
+	uint8_t footer[ kFooterSize ] = { 0 };
+	if ( fileSize >= kFileHeaderSize + kFooterSize ) {
+		mFile.seekg( fileSize - kFooterSize );
+		mFile.read( (char*)footer, kFooterSize );
+	}
+	uint64_t offset = readFixed( footer, 8 );
+	uint64_t count	= readFixed( footer + 8, 4 );
+	if ( !mFile || fileSize < kFileHeaderSize + kFooterSize || readFixed( footer + 12, 4 ) != kIndexMagic || 
+		 offset < kFileHeaderSize || offset > fileSize - kFooterSize ) {
+		scan();
+		return;
+	}
+
+	mBuffer.resize( (size_t)( fileSize - kFooterSize - offset ) );
+	mFile.seekg( offset );
+	if ( !mBuffer.empty() ) {
+		mFile.read( (char*)&mBuffer[ 0 ], mBuffer.size() );
+	}
+	ByteReader reader( mBuffer.empty() ? nullptr : &mBuffer[ 0 ], mBuffer.size() );
+	for ( uint64_t i = 0; i < count && !reader.hasError(); ++i ) {
+		Entry entry;
+		entry.mKey			= reader.readByte() != 0;
+		entry.mSequenceId	= reader.readSigned();
+		entry.mFrameId		= reader.readSigned();
+		entry.mOffset		= reader.readVarint();
+		mEntries.push_back( entry );
+	}
+	if ( !mFile || reader.hasError() ) {
+		mEntries.clear();
+		scan();
+	}
+}
+
+void ImageReader::scan()
+{
+	mFile.clear();
+	mFile.seekg( kFileHeaderSize );
+	while ( true ) {
+		Entry entry;
+		entry.mOffset = (uint64_t)mFile.tellg();
+
+		uint8_t header[ kRecordHeaderSize ];
+		if ( !mFile.read( (char*)header, kRecordHeaderSize ) || readFixed( header, 4 ) != kRecordMagic ) {
+			break;
+		}
+		mBuffer.resize( (size_t)readFixed( header + 4, 4 ) );
+		if ( mBuffer.empty() || !mFile.read( (char*)&mBuffer[ 0 ], mBuffer.size() ) ) {
+			break;
+		}
+
+		ByteReader reader( &mBuffer[ 0 ], mBuffer.size() );
+		entry.mKey			= reader.readByte() != 0;
+		entry.mFrameId		= reader.readSigned();
+		reader.readSigned();
+		entry.mSequenceId	= reader.readSigned();
+		if ( reader.hasError() ) {
+			break;
+		}
+		mEntries.push_back( entry );
+	}
+	mFile.clear();
+}
+
+bool ImageReader::isOpen() const
+{
+	return mFile.is_open();
+}
+
+size_t ImageReader::getNumFrames() const
+{
+	return mEntries.size();
+}
+
+int64_t ImageReader::getSequenceId( size_t index ) const
+{
+	return index < mEntries.size() ? mEntries[ index ].mSequenceId : -1;
+}
+
+bool ImageReader::read( RecordedImages& images )
+{
+	if ( mNext >= mEntries.size() || !prepare( mNext ) || !decode( mNext, images ) ) {
+		return false;
+	}
+	++mNext;
+	return true;
+}
+
+bool ImageReader::seek( int64_t sequenceId )
+{
+	// Sequence ids only increase through the file
+	size_t index = (size_t)( lower_bound( mEntries.begin(), mEntries.end(), sequenceId, 
+		[]( const Entry& entry, int64_t id )
+	{
+		return entry.mSequenceId < id;
+	} ) - mEntries.begin() );
+	if ( index >= mEntries.size() || !prepare( index ) ) {
+		return false;
+	}
+	mNext = index;
+	return true;
+}
+
+bool ImageReader::prepare( size_t index )
+{
+	if ( mEntries[ index ].mKey || mReferenceIndex == (int64_t)index - 1 ) {
+		return true;
+	}
+
+	// Decode up to the target from the nearest key frame, or from 
+	// the current references if they are already on the way
+	size_t start = index;
+	while ( start > 0 && !mEntries[ start ].mKey ) {
+		--start;
+	}
+	if ( mReferenceIndex >= (int64_t)start && mReferenceIndex < (int64_t)index ) {
+		start = (size_t)( mReferenceIndex + 1 );
+	}
+	RecordedImages images;
+	for ( size_t i = start; i < index; ++i ) {
+		if ( !decode( i, images ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ImageReader::decode( size_t index, RecordedImages& images )
+{
+	const Entry& entry = mEntries[ index ];
+	mReferenceIndex = -1;
+
+	uint8_t header[ kRecordHeaderSize ];
+	mFile.clear();
+	mFile.seekg( entry.mOffset );
+	if ( !mFile.read( (char*)header, kRecordHeaderSize ) || readFixed( header, 4 ) != kRecordMagic ) {
+		return false;
+	}
+	mBuffer.resize( (size_t)readFixed( header + 4, 4 ) );
+	if ( mBuffer.empty() || !mFile.read( (char*)&mBuffer[ 0 ], mBuffer.size() ) ) {
+		return false;
+	}
+
+	ByteReader reader( &mBuffer[ 0 ], mBuffer.size() );
+	reader.readByte();
+	images.mFrameId		= reader.readSigned();
+	images.mTimestamp	= reader.readSigned();
+	images.mSequenceId	= reader.readSigned();
+	size_t count		= (size_t)reader.readVarint();
+	if ( reader.hasError() || count > 16 ) {
+		return false;
+	}
+
+	images.mCameras.resize( count );
+	vector<uint8_t> residuals;
+	for ( size_t i = 0; i < count; ++i ) {
+		RecordedImages::Camera& camera	= images.mCameras[ i ];
+		camera.mId						= (int32_t)reader.readSigned();
+		camera.mWidth					= (int32_t)reader.readVarint();
+		camera.mHeight					= (int32_t)reader.readVarint();
+		uint8_t predictor				= reader.readByte();
+		if ( reader.hasError() || camera.mWidth <= 0 || camera.mHeight <= 0 || camera.mWidth > 4096 || camera.mHeight > 4096 ) {
+			return false;
+		}
+		size_t size = (size_t)camera.mWidth * camera.mHeight;
+		residuals.resize( size );
+		if ( !decodeRans( reader, &residuals[ 0 ], size ) ) {
+			return false;
+		}
+
+		RecordedImages::Camera* reference = nullptr;
+		for ( vector<RecordedImages::Camera>::iterator ref = mReference.begin(); ref != mReference.end(); ++ref ) {
+			if ( ref->mId == camera.mId ) {
+				reference = &*ref;
+			}
+		}
+		if ( reference == nullptr ) {
+			mReference.push_back( RecordedImages::Camera() );
+			reference		= &mReference.back();
+			reference->mId	= camera.mId;
+		}
+
+		camera.mData.resize( size );
+		if ( predictor == kPredictPrevious ) {
+			if ( reference->mWidth != camera.mWidth || reference->mHeight != camera.mHeight ) {
+				return false;
+			}
+			const uint8_t* prev = &reference->mData[ 0 ];
+			for ( size_t j = 0; j < size; ++j ) {
+				camera.mData[ j ] = (uint8_t)( residuals[ j ] + prev[ j ] );
+			}
+		} else {
+			unpredictSpatial( &residuals[ 0 ], camera.mWidth, camera.mHeight, &camera.mData[ 0 ] );
+		}
+		*reference = camera;
+	}
+	mReferenceIndex = (int64_t)index;
+	return true;
+}
+
+}
@@ -0,0 +1,171 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "ImagePyramid.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LeapMotion {
+
+//! Camera images of one recorded frame.
+struct RecordedImages
+{
+	RecordedImages();
+
+	struct Camera
+	{
+		Camera();
+
+		//! Returns view of \a mData.
+		ImageView				getView() const;
+
+		std::vector<uint8_t>	mData;
+		int32_t					mHeight;
+		int32_t					mId;
+		int32_t					mWidth;
+	};
+
+	std::vector<Camera>			mCameras;
+	int64_t						mFrameId;
+	int64_t						mSequenceId;
+	int64_t						mTimestamp;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class ImageRecorder> ImageRecorderRef;
+
+/*! Losslessly records raw camera images with their frame id and time 
+	stamp. Each image is predicted either from the same camera's previous 
+	image or spatially (LOCO-I median, SSE2 where available), whichever 
+	leaves smaller residuals, and the residuals are rANS coded. Key frames (spatial prediction only) are written at 
+	a fixed interval so ImageReader can seek. Encoding and disk writes 
+	run on a background thread. */
+class ImageRecorder
+{
+public:
+	/*! Creates \a path. Frames are queued up to \a queueSize, beyond 
+		which they are dropped rather than blocking the caller. */
+	static ImageRecorderRef	create( const std::string& path, uint32_t keyFrameInterval = 30, size_t queueSize = 64 );
+	//! Finishes writing queued frames and the seek index.
+	~ImageRecorder();
+
+	//! Queues images in \a frame. Frames without images are ignored. Thread-safe.
+	void					record( const Leap::Frame& frame );
+
+	//! Returns true if the file is open.
+	bool					isOpen() const;
+	//! Returns number of frames dropped because the queue was full.
+	uint64_t				getNumDropped() const;
+	//! Returns number of frames written.
+	uint64_t				getNumFrames() const;
+protected:
+	struct Entry;
+
+	ImageRecorder( const std::string& path, uint32_t keyFrameInterval, size_t queueSize );
+
+	void					run();
+	void					write( const Leap::Frame& frame );
+
+	std::condition_variable	mCondition;
+	std::atomic<uint64_t>	mDropped;
+	std::vector<uint8_t>	mBuffer;
+	std::vector<Entry>		mEntries;
+	bool					mExiting;
+	std::ofstream			mFile;
+	std::atomic<uint64_t>	mFrames;
+	uint32_t				mKeyFrameInterval;
+	std::mutex				mMutex;
+	std::deque<Leap::Frame>	mQueue;
+	size_t					mQueueSize;
+	//! Previous image per camera, for temporal prediction.
+	std::vector<RecordedImages::Camera>	mReference;
+	std::vector<uint8_t>	mResiduals;
+	std::thread				mThread;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class ImageReader> ImageReaderRef;
+
+//! Reads files written by ImageRecorder, in order or by sequence id.
+class ImageReader
+{
+public:
+	static ImageReaderRef	create( const std::string& path );
+
+	//! Returns true if the file was opened and indexed.
+	bool					isOpen() const;
+	//! Returns number of frames in the file.
+	size_t					getNumFrames() const;
+	//! Returns sequence id of frame at \a index.
+	int64_t					getSequenceId( size_t index ) const;
+
+	//! Decodes the next frame into \a images. Returns false at the end or on error.
+	bool					read( RecordedImages& images );
+	/*! Positions the reader so read() returns the first frame with a 
+		sequence id of at least \a sequenceId. Decodes forward from the 
+		nearest key frame. Returns false if there is no such frame. */
+	bool					seek( int64_t sequenceId );
+protected:
+	struct Entry;
+
+	ImageReader( const std::string& path );
+
+	bool					decode( size_t index, RecordedImages& images );
+	//! Brings references up to the frame before \a index.
+	bool					prepare( size_t index );
+	void					scan();
+
+	std::vector<uint8_t>	mBuffer;
+	std::vector<Entry>		mEntries;
+	std::ifstream			mFile;
+	size_t					mNext;
+	std::vector<RecordedImages::Camera>	mReference;
+	//! Index of the frame the references were decoded from, or -1.
+	int64_t					mReferenceIndex;
+};
+
+}
@@ -0,0 +1,168 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "Retargeter.h"
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+static inline quat toQuat( const Leap::Matrix& m, float flip )
+{
+	return glm::normalize( glm::quat_cast( mat3( toVec3( m.xBasis ), toVec3( m.yBasis ), toVec3( m.zBasis ) * flip ) ) );
+}
+
+// Snapshot bases are stored transposed, as by toMat3()
+static inline quat toQuat( const mat3& m, float flip )
+{
+	mat3 basis	= glm::transpose( m );
+	basis[ 2 ]	*= flip;
+	return glm::normalize( glm::quat_cast( basis ) );
+}
+
+HandPose::HandPose()
+: mLeft( false )
+{
+}
+
+void HandPose::capture( const Leap::Hand& hand )
+{
+	mLeft		= hand.isLeft();
+	float flip	= mLeft ? -1.0f : 1.0f;
+
+	mRotations[ HandMatrices::kPalm ]	= toQuat( hand.basis(), flip );
+	mRotations[ HandMatrices::kArm ]	= toQuat( hand.arm().basis(), flip );
+
+	const Leap::FingerList& fingers = hand.fingers();
+	for ( Leap::FingerList::const_iterator iter = fingers.begin(); iter != fingers.end(); ++iter ) {
+		const Leap::Finger& finger	= *iter;
+		int32_t type				= (int32_t)finger.type();
+		if ( type < 0 || type > 4 ) {
+			continue;
+		}
+		for ( int32_t i = 0; i < 4; ++i ) {
+			mRotations[ type * 4 + i ] = toQuat( finger.bone( (Leap::Bone::Type)i ).basis(), flip );
+		}
+	}
+}
+
+void HandPose::capture( const HandSnapshot& hand )
+{
+	mLeft		= hand.mLeft;
+	float flip	= mLeft ? -1.0f : 1.0f;
+
+	mRotations[ HandMatrices::kPalm ]	= toQuat( hand.mBasis, flip );
+	mRotations[ HandMatrices::kArm ]	= toQuat( hand.mArmBasis, flip );
+	for ( size_t i = 0; i < 20; ++i ) {
+		mRotations[ i ] = toQuat( hand.mFingers[ i / 4 ].mBones[ i % 4 ].mBasis, flip );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+Retargeter::Joint::Joint( int32_t parent, int32_t source, const quat& rest )
+: mParent( parent ), mRest( rest ), mSource( source )
+{
+}
+
+RetargeterRef Retargeter::create( const vector<Joint>& joints, const HandPose& sourceRest, const quat& space )
+{
+	return RetargeterRef( new Retargeter( joints, sourceRest, space ) );
+}
+
+Retargeter::Retargeter( const vector<Joint>& joints, const HandPose& sourceRest, const quat& space )
+: mJoints( joints ), mSpace( glm::normalize( space ) )
+{
+	// Target world = space * source * inverse( source rest ) * inverse( space ) * target rest. 
+	// Everything right of the source rotation is fixed per rig.
+	quat spaceInverse = glm::conjugate( mSpace );
+	for ( size_t i = 0; i < mJoints.size(); ++i ) {
+		Joint& joint = mJoints[ i ];
+		if ( joint.mParent >= (int32_t)i ) {
+			joint.mParent = -1;
+		}
+		if ( joint.mSource >= (int32_t)HandMatrices::kNumBones ) {
+			joint.mSource = -1;
+		}
+		joint.mRest = glm::normalize( joint.mRest );
+
+		quat correction;
+		if ( joint.mSource >= 0 ) {
+			correction = glm::conjugate( sourceRest.mRotations[ joint.mSource ] ) * spaceInverse * joint.mRest;
+		}
+		mCorrections.push_back( correction );
+
+		quat restLocal = joint.mRest;
+		if ( joint.mParent >= 0 ) {
+			restLocal = glm::conjugate( mJoints[ joint.mParent ].mRest ) * joint.mRest;
+		}
+		mRestLocal.push_back( restLocal );
+	}
+}
+
+const vector<Retargeter::Joint>& Retargeter::getJoints() const
+{
+	return mJoints;
+}
+
+void Retargeter::solve( const HandPose& pose, vector<quat>& local ) const
+{
+	size_t count = mJoints.size();
+	local.resize( count );
+
+	// World rotations first. Parents always precede children.
+	for ( size_t i = 0; i < count; ++i ) {
+		const Joint& joint = mJoints[ i ];
+		if ( joint.mSource >= 0 ) {
+			local[ i ] = mSpace * pose.mRotations[ joint.mSource ] * mCorrections[ i ];
+		} else if ( joint.mParent >= 0 ) {
+			local[ i ] = local[ joint.mParent ] * mRestLocal[ i ];
+		} else {
+			local[ i ] = mRestLocal[ i ];
+		}
+	}
+
+	// Convert to parent relative in reverse so parents are still in world space
+	for ( size_t i = count; i > 0; --i ) {
+		const Joint& joint = mJoints[ i - 1 ];
+		if ( joint.mParent >= 0 ) {
+			local[ i - 1 ] = glm::normalize( glm::conjugate( local[ joint.mParent ] ) * local[ i - 1 ] );
+		}
+	}
+}
+
+}
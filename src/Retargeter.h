@@ -0,0 +1,110 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include "cinder/Quaternion.h"
+#include <memory>
+#include <vector>
+
+namespace LeapMotion {
+
+/*! World rotations of one tracked hand, indexed like HandMatrices. 
+	Left hand bases are converted to the right-hand rule. Capture once 
+	per frame and share it between every Retargeter driven by the hand. 
+	Default constructed, every joint is identity: a flat hand, palm 
+	down, fingers pointing along -z in device space. */
+struct HandPose
+{
+	HandPose();
+
+	void				capture( const Leap::Hand& hand );
+	void				capture( const HandSnapshot& hand );
+
+	bool				mLeft;
+	ci::quat			mRotations[ HandMatrices::kNumBones ];
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class Retargeter> RetargeterRef;
+
+/*! Maps HandPose rotations onto an avatar rig with its own 
+	proportions and rest pose. Only orientations are transferred, so 
+	the rig keeps its bone lengths. Rest pose corrections are computed 
+	once in create(); solve() costs two or three quaternion products 
+	per joint. */
+class Retargeter
+{
+public:
+	struct Joint
+	{
+		Joint( int32_t parent = -1, int32_t source = -1, const ci::quat& rest = ci::quat() );
+
+		//! Index of parent joint. Must be lower than this joint's index, or -1 for a root.
+		int32_t			mParent;
+		//! World (model space) rotation of the joint in the rig's rest pose.
+		ci::quat		mRest;
+		//! HandMatrices index driving this joint, or -1 to follow the parent.
+		int32_t			mSource;
+	};
+
+	/*! Creates solver for \a joints. \a sourceRest is the tracked hand 
+		in the pose matching the rig's rest pose (eg, captured during 
+		calibration). \a space rotates device space into model space. */
+	static RetargeterRef	create( const std::vector<Joint>& joints, 
+									const HandPose& sourceRest = HandPose(), 
+									const ci::quat& space = ci::quat() );
+
+	/*! Writes one local (parent relative) rotation per joint into 
+		\a local. Roots are relative to model space. */
+	void					solve( const HandPose& pose, std::vector<ci::quat>& local ) const;
+
+	//! Returns the rig's joints.
+	const std::vector<Joint>&	getJoints() const;
+protected:
+	Retargeter( const std::vector<Joint>& joints, const HandPose& sourceRest, const ci::quat& space );
+
+	//! Maps device space rotation to model space and applies rest correction.
+	std::vector<ci::quat>	mCorrections;
+	std::vector<Joint>		mJoints;
+	//! Rest rotation relative to parent, used by joints without a source.
+	std::vector<ci::quat>	mRestLocal;
+	ci::quat				mSpace;
+};
+
+}
@@ -0,0 +1,316 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+#if defined( _WIN32 )
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#elif defined( __linux__ )
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+using namespace ci;
+using namespace std;
+
+namespace LeapMotion {
+
+Task::Task( const function<void()>& work )
+: mDone( false ), mPending( 1 ), mWork( work )
+{
+}
+
+bool Task::isDone() const
+{
+	return mDone;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+TaskScheduler::Options::Options()
+: mAffinity( false ), mFirstCore( 0 ), mNumThreads( 0 )
+{
+}
+
+TaskSchedulerRef TaskScheduler::create( const Options& options )
+{
+	return TaskSchedulerRef( new TaskScheduler( options ) );
+}
+
+TaskScheduler::TaskScheduler( const Options& options )
+: mExiting( false ), mNext( 0 ), mOptions( options ), mQueued( 0 ), mWaiting( 0 )
+{
+	const size_t numCores	= (size_t)max( thread::hardware_concurrency(), 1u );
+	size_t numThreads		= mOptions.mNumThreads;
+	if ( numThreads == 0 ) {
+		numThreads = max( numCores - 1, (size_t)1 );
+	}
+
+	// All deques exist before any worker can steal from them
+	for ( size_t i = 0; i < numThreads; ++i ) {
+		mWorkers.push_back( unique_ptr<Worker>( new Worker() ) );
+	}
+	for ( size_t i = 0; i < numThreads; ++i ) {
+		thread& worker = mWorkers[ i ]->mThread;
+		worker = thread( &TaskScheduler::run, this, i );
+		if ( mOptions.mAffinity ) {
+			const size_t core = ( mOptions.mFirstCore + i ) % numCores;
+#if defined( _WIN32 )
+			SetThreadAffinityMask( worker.native_handle(), (DWORD_PTR)1 << core );
+#elif defined( __linux__ )
+			cpu_set_t set;
+			CPU_ZERO( &set );
+			CPU_SET( core, &set );
+			pthread_setaffinity_np( worker.native_handle(), sizeof( set ), &set );
+#endif
+		}
+	}
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		lock_guard<mutex> lock( mMutex );
+		mExiting = true;
+	}
+	mCondition.notify_all();
+	for ( vector<unique_ptr<Worker>>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter ) {
+		if ( ( *iter )->mThread.joinable() ) {
+			( *iter )->mThread.join();
+		}
+	}
+}
+
+TaskRef TaskScheduler::submit( const function<void()>& work, const vector<TaskRef>& dependencies )
+{
+	TaskRef task( new Task( work ) );
+	for ( vector<TaskRef>::const_iterator iter = dependencies.begin(); iter != dependencies.end(); ++iter ) {
+		const TaskRef& dependency = *iter;
+		if ( dependency ) {
+			lock_guard<mutex> lock( dependency->mMutex );
+			if ( !dependency->mDone ) {
+				dependency->mDependents.push_back( task );
+				++task->mPending;
+			}
+		}
+	}
+
+	// Drops the hold taken at construction, so dependencies finishing
+	// during the loop above can't release the task early
+	release( task );
+	return task;
+}
+
+TaskRef TaskScheduler::parallelFor( size_t count, const function<void( size_t )>& work, size_t grain,
+									const vector<TaskRef>& dependencies )
+{
+	grain = max( grain, (size_t)1 );
+	vector<TaskRef> ranges;
+	for ( size_t begin = 0; begin < count; begin += grain ) {
+		const size_t end = min( begin + grain, count );
+		ranges.push_back( submit( [ begin, end, work ]()
+		{
+			for ( size_t i = begin; i < end; ++i ) {
+				work( i );
+			}
+		}, dependencies ) );
+	}
+	if ( ranges.empty() ) {
+		ranges = dependencies;
+	}
+	return submit( []() {}, ranges );
+}
+
+void TaskScheduler::wait( const TaskRef& task )
+{
+	if ( !task ) {
+		return;
+	}
+	const int32_t index = getWorkerIndex();
+	while ( !task->isDone() ) {
+		const TaskRef next = take( index );
+		if ( next ) {
+			execute( next );
+		} else {
+			// Nothing to help with; sleep until work is queued or a task finishes
+			++mWaiting;
+			{
+				unique_lock<mutex> lock( mMutex );
+				mCondition.wait( lock, [ this, &task ]()
+				{
+					return task->isDone() || mQueued > 0;
+				} );
+			}
+			--mWaiting;
+		}
+	}
+}
+
+TaskExecutor TaskScheduler::getExecutor()
+{
+	return [ this ]( const function<void()>& work )
+	{
+		submit( work );
+	};
+}
+
+size_t TaskScheduler::getNumThreads() const
+{
+	return mWorkers.size();
+}
+
+const TaskScheduler::Options& TaskScheduler::getOptions() const
+{
+	return mOptions;
+}
+
+int32_t TaskScheduler::getWorkerIndex() const
+{
+	const thread::id id = this_thread::get_id();
+	for ( size_t i = 0; i < mWorkers.size(); ++i ) {
+		if ( mWorkers[ i ]->mThread.get_id() == id ) {
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+void TaskScheduler::execute( const TaskRef& task )
+{
+	task->mWork();
+	task->mWork = nullptr;
+
+	vector<TaskRef> dependents;
+	{
+		lock_guard<mutex> lock( task->mMutex );
+		task->mDone = true;
+		dependents.swap( task->mDependents );
+	}
+	for ( vector<TaskRef>::const_iterator iter = dependents.begin(); iter != dependents.end(); ++iter ) {
+		release( *iter );
+	}
+
+	if ( mWaiting > 0 ) {
+		lock_guard<mutex> lock( mMutex );
+		mCondition.notify_all();
+	}
+}
+
+void TaskScheduler::release( const TaskRef& task )
+{
+	if ( --task->mPending == 0 ) {
+		schedule( task );
+	}
+}
+
+void TaskScheduler::run( size_t index )
+{
+	while ( true ) {
+		const TaskRef task = take( (int32_t)index );
+		if ( task ) {
+			execute( task );
+			continue;
+		}
+
+		unique_lock<mutex> lock( mMutex );
+		mCondition.wait( lock, [ this ]()
+		{
+			return mExiting || mQueued > 0;
+		} );
+		if ( mExiting && mQueued == 0 ) {
+			break;
+		}
+	}
+}
+
+void TaskScheduler::schedule( const TaskRef& task )
+{
+	// Workers keep their own tasks close; other threads spread theirs out
+	int32_t index = getWorkerIndex();
+	if ( index < 0 ) {
+		index = (int32_t)( mNext++ % mWorkers.size() );
+	}
+	Worker& worker = *mWorkers[ index ];
+	{
+		lock_guard<mutex> lock( worker.mMutex );
+		worker.mTasks.push_back( task );
+		++mQueued;
+	}
+	lock_guard<mutex> lock( mMutex );
+	mCondition.notify_one();
+}
+
+TaskRef TaskScheduler::take( int32_t index )
+{
+	TaskRef task;
+	if ( mQueued == 0 ) {
+		return task;
+	}
+
+	// Newest of our own first, as its data is most likely still in cache
+	if ( index >= 0 ) {
+		Worker& worker = *mWorkers[ index ];
+		lock_guard<mutex> lock( worker.mMutex );
+		if ( !worker.mTasks.empty() ) {
+			task = worker.mTasks.back();
+			worker.mTasks.pop_back();
+			--mQueued;
+			return task;
+		}
+	}
+
+	// Otherwise steal the oldest from someone else
+	const size_t count = mWorkers.size();
+	const size_t start = index >= 0 ? (size_t)index + 1 : mNext.load();
+	for ( size_t i = 0; i < count; ++i ) {
+		Worker& victim = *mWorkers[ ( start + i ) % count ];
+		lock_guard<mutex> lock( victim.mMutex );
+		if ( !victim.mTasks.empty() ) {
+			task = victim.mTasks.front();
+			victim.mTasks.pop_front();
+			--mQueued;
+			return task;
+		}
+	}
+	return task;
+}
+
+}
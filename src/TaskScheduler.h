@@ -0,0 +1,237 @@
+/*
+* 
+* Copyright (c) 2016, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "Cinder-LeapMotion.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LeapMotion {
+
+typedef std::shared_ptr<class Task>				TaskRef;
+typedef std::shared_ptr<class TaskScheduler>	TaskSchedulerRef;
+
+//! Unit of work submitted to a TaskScheduler. Use as a dependency of later tasks.
+class Task
+{
+public:
+	//! Returns true once the work has run.
+	bool					isDone() const;
+protected:
+	Task( const std::function<void()>& work );
+
+	std::vector<TaskRef>	mDependents;
+	std::atomic<bool>		mDone;
+	std::mutex				mMutex;
+	std::atomic<int32_t>	mPending;
+	std::function<void()>	mWork;
+
+	friend class			TaskScheduler;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Work-stealing job system for fanning per-hand, per-finger and
+	per-image work out across cores. Each worker owns a deque: it pushes
+	and pops its own tasks at the back, while idle workers steal the
+	oldest task from the front of another's. Tasks run once all of their
+	dependencies have, so stages within a frame can be expressed as a
+	graph. Threads calling wait() run queued tasks instead of blocking,
+	so tasks may wait on tasks they submit. */
+class TaskScheduler
+{
+public:
+	struct Options
+	{
+		Options();
+
+		//! Number of worker threads. Zero uses the hardware concurrency, less one for the app thread.
+		Options&		numThreads( size_t v ) { mNumThreads = v; return *this; }
+		//! Pins worker i to core \a firstCore + i, wrapping at the core count. Not supported on OS X.
+		Options&		affinity( bool v ) { mAffinity = v; return *this; }
+		//! First core workers are pinned to when affinity is enabled.
+		Options&		firstCore( size_t v ) { mFirstCore = v; return *this; }
+
+		bool			mAffinity;
+		size_t			mFirstCore;
+		size_t			mNumThreads;
+	};
+
+	static TaskSchedulerRef	create( const Options& options = Options() );
+	//! Runs all queued tasks before joining the workers.
+	~TaskScheduler();
+
+	//! Queues \a work to run after every task in \a dependencies.
+	TaskRef					submit( const std::function<void()>& work,
+									const std::vector<TaskRef>& dependencies = std::vector<TaskRef>() );
+	/*! Calls \a work for each index in [0, \a count) across the workers,
+		\a grain indices per task. Returns a task which completes after the
+		last index, without waiting for it. */
+	TaskRef					parallelFor( size_t count, const std::function<void( size_t )>& work, size_t grain = 1,
+										 const std::vector<TaskRef>& dependencies = std::vector<TaskRef>() );
+	//! Runs queued tasks on the calling thread until \a task is done.
+	void					wait( const TaskRef& task );
+
+	/*! Returns an executor for Device::subscribe() which runs frame
+		handlers on this scheduler. The scheduler must outlive the
+		subscription. */
+	TaskExecutor			getExecutor();
+	//! Returns number of worker threads.
+	size_t					getNumThreads() const;
+	const Options&			getOptions() const;
+protected:
+	TaskScheduler( const Options& options );
+
+	struct Worker
+	{
+		std::mutex			mMutex;
+		std::deque<TaskRef>	mTasks;
+		std::thread			mThread;
+	};
+
+	//! Returns index of the calling worker, or -1 from other threads.
+	int32_t					getWorkerIndex() const;
+	void					execute( const TaskRef& task );
+	void					release( const TaskRef& task );
+	void					run( size_t index );
+	void					schedule( const TaskRef& task );
+	TaskRef					take( int32_t index );
+
+	std::condition_variable	mCondition;
+	bool					mExiting;
+	std::mutex				mMutex;
+	std::atomic<size_t>		mNext;
+	Options					mOptions;
+	std::atomic<size_t>		mQueued;
+	std::atomic<size_t>		mWaiting;
+	std::vector<std::unique_ptr<Worker>>	mWorkers;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Runs frames through a chain of stages on a TaskScheduler, so
+	frame N + 1 can be in an early stage while frame N is still in a
+	later one. Each stage sees frames in the order they were pushed and
+	only after the previous stage has finished with that frame. Stages
+	share a \a T per frame for their results and may fan out with
+	TaskScheduler::parallelFor(). */
+template<typename T>
+class FramePipeline
+{
+public:
+	typedef std::function<void( const Leap::Frame&, T& )> Stage;
+
+	//! At most \a maxFrames frames are in flight. Frames pushed beyond that are dropped.
+	FramePipeline( const TaskSchedulerRef& scheduler, size_t maxFrames = 2 )
+	: mInFlight( 0 ), mMaxFrames( maxFrames ), mNumDropped( 0 ), mScheduler( scheduler )
+	{
+	}
+
+	//! Waits for frames in flight, as stages may refer to the pipeline's owner.
+	~FramePipeline()
+	{
+		wait();
+	}
+
+	//! Appends \a stage. Add all stages before the first push().
+	FramePipeline&	addStage( const Stage& stage )
+	{
+		mStages.push_back( stage );
+		mLast.push_back( TaskRef() );
+		return *this;
+	}
+
+	//! Starts \a frame through the stages. Returns false if it was dropped.
+	bool push( const Leap::Frame& frame )
+	{
+		if ( mStages.empty() || mInFlight >= mMaxFrames ) {
+			++mNumDropped;
+			return false;
+		}
+		++mInFlight;
+
+		const std::shared_ptr<T> state	= std::make_shared<T>();
+		TaskRef previous;
+		for ( size_t i = 0; i < mStages.size(); ++i ) {
+			std::vector<TaskRef> dependencies;
+			if ( previous ) {
+				dependencies.push_back( previous );
+			}
+			if ( mLast[ i ] ) {
+				dependencies.push_back( mLast[ i ] );
+			}
+
+			const Stage& stage		= mStages[ i ];
+			std::atomic<size_t>* count	= i + 1 == mStages.size() ? &mInFlight : nullptr;
+			previous = mScheduler->submit( [ count, frame, stage, state ]()
+			{
+				stage( frame, *state );
+				if ( count != nullptr ) {
+					--( *count );
+				}
+			}, dependencies );
+			mLast[ i ] = previous;
+		}
+		return true;
+	}
+
+	//! Blocks until every pushed frame has left the last stage.
+	void wait()
+	{
+		if ( !mLast.empty() && mLast.back() ) {
+			mScheduler->wait( mLast.back() );
+		}
+	}
+
+	size_t				getNumDropped() const { return mNumDropped; }
+	size_t				getNumInFlight() const { return mInFlight; }
+	const TaskSchedulerRef&	getScheduler() const { return mScheduler; }
+protected:
+	std::atomic<size_t>	mInFlight;
+	std::vector<TaskRef>	mLast;
+	size_t				mMaxFrames;
+	size_t				mNumDropped;
+	TaskSchedulerRef	mScheduler;
+	std::vector<Stage>	mStages;
+};
+
+}
@@ -0,0 +1,205 @@
+/*
+	Round-trip check and benchmark for FrameEncoder / FrameDecoder.
+	Console program built by tools/CMakeLists.txt, or by hand. Only
+	FrameCodec.cpp and Cinder's headers are needed:
+
+	g++ -std=c++11 -O2 -I../../src -I$CINDER/include \
+		FrameCodecBench.cpp ../../src/FrameCodec.cpp -o FrameCodecBench
+
+	Synthetic frames (including hands and elbows outside the interaction
+	box) are encoded and decoded, and every position is checked against
+	the quantization step. Exits non-zero on a mismatch.
+
+	Define FRAMECODEC_BENCH_LIVE to also encode frames from a connected
+	device and compare them against Leap::Frame::serialize(). This
+	captures snapshots, so it also needs Cinder-LeapMotion.cpp, libcinder
+	and the Leap SDK:
+
+	g++ -std=c++11 -O2 -DFRAMECODEC_BENCH_LIVE -I../../src -I$CINDER/include \
+		FrameCodecBench.cpp ../../src/FrameCodec.cpp ../../src/Cinder-LeapMotion.cpp \
+		-L$CINDER/lib -lcinder -L../../lib/macosx -lLeap
+*/
+
+#include "FrameCodec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#if defined( FRAMECODEC_BENCH_LIVE )
+	#include <thread>
+#endif
+
+using namespace ci;
+using namespace LeapMotion;
+using namespace std;
+
+static const int32_t	kNumFrames		= 20000;
+static const float		kPositionError	= 1.0f / 64.0f + 0.0001f;
+
+typedef chrono::high_resolution_clock Clock;
+
+static double elapsedMicroseconds( const Clock::time_point& start )
+{
+	return (double)chrono::duration_cast<chrono::nanoseconds>( Clock::now() - start ).count() / 1000.0;
+}
+
+// Hand \a index drifts along a path, every other one well outside the box
+static void makeHand( HandSnapshot& hand, int32_t index, int32_t frame, mt19937& random )
+{
+	normal_distribution<float> noise( 0.0f, 0.2f );
+	const float t		= (float)frame / 110.0f;
+	const bool outside	= index % 2 == 1;
+	vec3 palm( -80.0f + 160.0f * (float)index + 30.0f * sinf( t ), 200.0f + 40.0f * cosf( t * 0.7f ), 20.0f * sinf( t * 1.3f ) );
+	if ( outside ) {
+		palm += vec3( 350.0f, 280.0f, 260.0f );
+	}
+
+	hand						= HandSnapshot();
+	hand.mId					= index + 1;
+	hand.mLeft					= index % 2 == 0;
+	hand.mConfidence			= 1.0f;
+	hand.mDirection				= vec3( 0.0f, 0.0f, -1.0f );
+	hand.mPalmNormal			= vec3( 0.0f, -1.0f, 0.0f );
+	hand.mPalmPosition			= palm;
+	hand.mStabilizedPalmPosition	= palm;
+	hand.mPalmWidth				= 85.0f;
+	hand.mArmWidth				= 60.0f;
+	hand.mWristPosition			= palm + vec3( 0.0f, 0.0f, 60.0f );
+	hand.mElbowPosition			= hand.mWristPosition + vec3( 0.0f, -30.0f, 250.0f );
+	hand.mTimeVisible			= t;
+	for ( int32_t i = 0; i < 5; ++i ) {
+		FingerSnapshot& finger = hand.mFingers[ i ];
+		finger.mWidth	= 18.0f;
+		vec3 joint		= palm + vec3( -40.0f + 20.0f * (float)i, 0.0f, 40.0f );
+		for ( int32_t j = 0; j < 4; ++j ) {
+			finger.mBones[ j ].mPrevJoint = joint;
+			joint += vec3( noise( random ), noise( random ), -25.0f );
+			finger.mBones[ j ].mNextJoint = joint;
+		}
+	}
+}
+
+static float maxError( const vec3& a, const vec3& b )
+{
+	const vec3 d = glm::abs( a - b );
+	return max( d.x, max( d.y, d.z ) );
+}
+
+static float maxPositionError( const HandSnapshot& a, const HandSnapshot& b )
+{
+	float error = 0.0f;
+	error = max( error, maxError( a.mPalmPosition, b.mPalmPosition ) );
+	error = max( error, maxError( a.mWristPosition, b.mWristPosition ) );
+	error = max( error, maxError( a.mElbowPosition, b.mElbowPosition ) );
+	for ( int32_t i = 0; i < 5; ++i ) {
+		for ( int32_t j = 0; j < 4; ++j ) {
+			error = max( error, maxError( a.mFingers[ i ].mBones[ j ].mPrevJoint, b.mFingers[ i ].mBones[ j ].mPrevJoint ) );
+			error = max( error, maxError( a.mFingers[ i ].mBones[ j ].mNextJoint, b.mFingers[ i ].mBones[ j ].mNextJoint ) );
+		}
+	}
+	return error;
+}
+
+static bool runSynthetic()
+{
+	mt19937 random( 1 );
+	vector<FrameSnapshot> frames( kNumFrames );
+	for ( int32_t i = 0; i < kNumFrames; ++i ) {
+		FrameSnapshot& frame	= frames[ i ];
+		frame					= FrameSnapshot();
+		frame.mBoxCenter		= vec3( 0.0f, 200.0f, 0.0f );
+		frame.mBoxSize			= vec3( 235.0f, 235.0f, 147.0f );
+		frame.mFields			= FIELD_ALL;
+		frame.mFramesPerSecond	= 110.0f;
+		frame.mId				= 1000 + i;
+		frame.mNumHands			= 2;
+		frame.mTimestamp		= 1000000 + i * 9091;
+		for ( int32_t j = 0; j < 2; ++j ) {
+			makeHand( frame.mHands[ j ], j, i, random );
+		}
+	}
+
+	FrameEncoder encoder;
+	vector<uint8_t> buffer;
+	vector<size_t> offsets;
+	Clock::time_point start = Clock::now();
+	for ( int32_t i = 0; i < kNumFrames; ++i ) {
+		offsets.push_back( buffer.size() );
+		encoder.encode( frames[ i ], buffer );
+	}
+	const double encodeTime = elapsedMicroseconds( start );
+	offsets.push_back( buffer.size() );
+
+	FrameDecoder decoder;
+	vector<FrameSnapshot> decoded( kNumFrames );
+	start = Clock::now();
+	for ( int32_t i = 0; i < kNumFrames; ++i ) {
+		decoder.decode( &buffer[ offsets[ i ] ], offsets[ i + 1 ] - offsets[ i ], decoded[ i ] );
+	}
+	const double decodeTime = elapsedMicroseconds( start );
+
+	float error = 0.0f;
+	bool ok		= true;
+	for ( int32_t i = 0; i < kNumFrames; ++i ) {
+		if ( decoded[ i ].mId != frames[ i ].mId || decoded[ i ].mNumHands != frames[ i ].mNumHands ) {
+			ok = false;
+			continue;
+		}
+		for ( uint32_t j = 0; j < frames[ i ].mNumHands; ++j ) {
+			error = max( error, maxPositionError( frames[ i ].mHands[ j ], decoded[ i ].mHands[ j ] ) );
+		}
+	}
+	ok = ok && error <= kPositionError;
+
+	printf( "synthetic: %d frames, 2 hands (one outside the box)\n", kNumFrames );
+	printf( "  encoded   %.1f bytes/frame (snapshot %d bytes)\n", (double)buffer.size() / kNumFrames, (int32_t)sizeof( FrameSnapshot ) );
+	printf( "  encode    %.2f us/frame\n", encodeTime / kNumFrames );
+	printf( "  decode    %.2f us/frame\n", decodeTime / kNumFrames );
+	printf( "  max error %.4f mm (limit %.4f) %s\n", error, kPositionError, ok ? "ok" : "FAILED" );
+	return ok;
+}
+
+#if defined( FRAMECODEC_BENCH_LIVE )
+static void runLive()
+{
+	Leap::Controller controller;
+	for ( int32_t i = 0; i < 30 && !controller.isConnected(); ++i ) {
+		this_thread::sleep_for( chrono::milliseconds( 100 ) );
+	}
+	if ( !controller.isConnected() ) {
+		printf( "live: no device, skipped\n" );
+		return;
+	}
+
+	FrameEncoder encoder;
+	vector<uint8_t> buffer;
+	size_t serialized	= 0;
+	int32_t count		= 0;
+	int64_t id			= -1;
+	while ( count < 1000 ) {
+		const Leap::Frame frame = controller.frame();
+		if ( frame.id() == id || frame.hands().isEmpty() ) {
+			this_thread::sleep_for( chrono::milliseconds( 1 ) );
+			continue;
+		}
+		id = frame.id();
+		FrameSnapshot snapshot;
+		snapshot.capture( frame );
+		encoder.encode( snapshot, buffer );
+		serialized += frame.serialize().size();
+		++count;
+	}
+	printf( "live: %d frames with hands\n", count );
+	printf( "  serialize %.1f bytes/frame\n", (double)serialized / count );
+	printf( "  encoded   %.1f bytes/frame (%.1fx smaller)\n", (double)buffer.size() / count, (double)serialized / (double)buffer.size() );
+}
+#endif
+
+int main( int argc, char* argv[] )
+{
+	const bool ok = runSynthetic();
+#if defined( FRAMECODEC_BENCH_LIVE )
+	runLive();
+#endif
+	return ok ? 0 : 1;
+}
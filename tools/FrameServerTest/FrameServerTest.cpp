@@ -0,0 +1,346 @@
+/*
+	Loopback test for FrameServer. Console program built by
+	tools/CMakeLists.txt, or by hand:
+
+	g++ -std=c++11 -O2 -I../../src -I$CINDER/include \
+		FrameServerTest.cpp ../../src/FrameServer.cpp ../../src/FrameCodec.cpp \
+		-lpthread -o FrameServerTest
+
+	Starts a server on 127.0.0.1 with one FrameClient over UDP and one
+	WebSocket client, which does its own handshake and framing. Every
+	synthetic frame sent must arrive at both and decode identically,
+	including frames left in a part-filled packet when sending stops.
+	The WebSocket client then stops reading until its queue overflows,
+	and must resynchronize from the key frame which follows. Exits
+	non-zero on failure.
+*/
+
+#include "ByteStream.h"
+#include "FrameServer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if defined( _WIN32 )
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#if defined( _MSC_VER )
+		#pragma comment( lib, "ws2_32.lib" )
+	#endif
+	typedef SOCKET SocketHandle;
+#else
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	typedef int SocketHandle;
+#endif
+
+using namespace ci;
+using namespace LeapMotion;
+using namespace std;
+
+static const int32_t	kNumFrames		= 200;
+static const float		kPositionError	= 1.0f / 64.0f + 0.0001f;
+
+static int32_t gFailures = 0;
+
+static void check( bool condition, const char* message )
+{
+	if ( !condition ) {
+		printf( "FAILED: %s\n", message );
+		++gFailures;
+	}
+}
+
+static void sleepMilliseconds( int32_t ms )
+{
+	this_thread::sleep_for( chrono::milliseconds( ms ) );
+}
+
+static FrameSnapshot makeFrame( int64_t id )
+{
+	FrameSnapshot frame		= FrameSnapshot();
+	frame.mBoxCenter		= vec3( 0.0f, 200.0f, 0.0f );
+	frame.mBoxSize			= vec3( 235.0f, 235.0f, 147.0f );
+	frame.mFields			= FIELD_ALL;
+	frame.mFramesPerSecond	= 110.0f;
+	frame.mId				= id;
+	frame.mNumHands			= 1;
+	frame.mTimestamp		= 1000000 + id * 9091;
+
+	const float t		= (float)id / 30.0f;
+	HandSnapshot& hand	= frame.mHands[ 0 ];
+	hand.mId			= 7;
+	hand.mConfidence	= 1.0f;
+	hand.mDirection		= vec3( 0.0f, 0.0f, -1.0f );
+	hand.mPalmNormal	= vec3( 0.0f, -1.0f, 0.0f );
+	hand.mPalmPosition	= vec3( 40.0f * sinf( t ), 200.0f + 30.0f * cosf( t ), 10.0f * sinf( t * 2.0f ) );
+	hand.mStabilizedPalmPosition	= hand.mPalmPosition;
+	hand.mPalmWidth		= 85.0f;
+	hand.mWristPosition	= hand.mPalmPosition + vec3( 0.0f, 0.0f, 60.0f );
+	hand.mElbowPosition	= hand.mWristPosition + vec3( 0.0f, -30.0f, 250.0f );
+	for ( int32_t i = 0; i < 5; ++i ) {
+		vec3 joint = hand.mPalmPosition + vec3( -40.0f + 20.0f * (float)i, 0.0f, 40.0f );
+		for ( int32_t j = 0; j < 4; ++j ) {
+			hand.mFingers[ i ].mBones[ j ].mPrevJoint = joint;
+			joint += vec3( 0.0f, -2.0f * sinf( t + (float)j ), -25.0f );
+			hand.mFingers[ i ].mBones[ j ].mNextJoint = joint;
+		}
+	}
+	return frame;
+}
+
+static float positionError( const FrameSnapshot& a, const FrameSnapshot& b )
+{
+	const HandSnapshot& x	= a.mHands[ 0 ];
+	const HandSnapshot& y	= b.mHands[ 0 ];
+	float error				= 0.0f;
+	const vec3* pairs[][ 2 ] = {
+		{ &x.mPalmPosition, &y.mPalmPosition },
+		{ &x.mWristPosition, &y.mWristPosition },
+		{ &x.mElbowPosition, &y.mElbowPosition },
+		{ &x.mFingers[ 4 ].mBones[ 3 ].mNextJoint, &y.mFingers[ 4 ].mBones[ 3 ].mNextJoint }
+	};
+	for ( size_t i = 0; i < 4; ++i ) {
+		for ( int32_t j = 0; j < 3; ++j ) {
+			error = max( error, fabsf( ( *pairs[ i ][ 0 ] )[ j ] - ( *pairs[ i ][ 1 ] )[ j ] ) );
+		}
+	}
+	return error;
+}
+
+// Minimal WebSocket client: handshake, then unmasked binary messages
+// holding FrameServer packets
+class WebSocketClient
+{
+public:
+	WebSocketClient()
+	: mSocket( (SocketHandle)-1 )
+	{
+	}
+
+	~WebSocketClient()
+	{
+		if ( mSocket != (SocketHandle)-1 ) {
+#if defined( _WIN32 )
+			closesocket( mSocket );
+#else
+			close( mSocket );
+#endif
+		}
+	}
+
+	bool connect( uint16_t port )
+	{
+		mSocket = socket( AF_INET, SOCK_STREAM, 0 );
+		sockaddr_in address;
+		memset( &address, 0, sizeof( address ) );
+		address.sin_family		= AF_INET;
+		address.sin_addr.s_addr	= htonl( INADDR_LOOPBACK );
+		address.sin_port		= htons( port );
+
+		// A small receive window lets the server's queue back up quickly
+		int size = 4096;
+		setsockopt( mSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof( size ) );
+		if ( ::connect( mSocket, (sockaddr*)&address, sizeof( address ) ) != 0 ) {
+			return false;
+		}
+
+		// Key and accept value from the example in RFC 6455
+		const string request =
+			"GET / HTTP/1.1\r\n"
+			"Host: 127.0.0.1\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n\r\n";
+		::send( mSocket, request.c_str(), (int)request.size(), 0 );
+
+		string response;
+		char c;
+		while ( response.find( "\r\n\r\n" ) == string::npos && recv( mSocket, &c, 1, 0 ) == 1 ) {
+			response.push_back( c );
+		}
+#if defined( _WIN32 )
+		u_long mode = 1;
+		ioctlsocket( mSocket, FIONBIO, &mode );
+#else
+		fcntl( mSocket, F_SETFL, fcntl( mSocket, F_GETFL, 0 ) | O_NONBLOCK );
+#endif
+		return response.find( "HTTP/1.1 101" ) == 0 &&
+			response.find( "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n" ) != string::npos;
+	}
+
+	//! Decodes all complete messages. Returns false if any frame failed to decode.
+	bool receive( vector<FrameSnapshot>& frames )
+	{
+		char buffer[ 4096 ];
+		int received;
+		while ( ( received = (int)recv( mSocket, buffer, sizeof( buffer ), 0 ) ) > 0 ) {
+			mInput.insert( mInput.end(), buffer, buffer + received );
+		}
+
+		bool ok = true;
+		while ( mInput.size() >= 2 ) {
+			size_t header	= 2;
+			uint64_t length	= mInput[ 1 ] & 0x7F;
+			if ( length == 126 ) {
+				if ( mInput.size() < 4 ) {
+					break;
+				}
+				length = ( (uint64_t)mInput[ 2 ] << 8 ) | mInput[ 3 ];
+				header = 4;
+			} else if ( length == 127 ) {
+				if ( mInput.size() < 10 ) {
+					break;
+				}
+				length = 0;
+				for ( size_t i = 2; i < 10; ++i ) {
+					length = ( length << 8 ) | mInput[ i ];
+				}
+				header = 10;
+			}
+			if ( mInput.size() < header + length ) {
+				break;
+			}
+
+			ByteReader reader( &mInput[ header ], (size_t)length );
+			const uint8_t count = reader.readByte();
+			for ( uint8_t i = 0; i < count; ++i ) {
+				const size_t size		= (size_t)reader.readVarint();
+				const uint8_t* data		= reader.readBytes( size );
+				FrameSnapshot frame;
+				if ( data == nullptr || mDecoder.decode( data, size, frame ) == 0 ) {
+					ok = false;
+					break;
+				}
+				frames.push_back( frame );
+			}
+			mInput.erase( mInput.begin(), mInput.begin() + (size_t)( header + length ) );
+		}
+		return ok;
+	}
+protected:
+	FrameDecoder			mDecoder;
+	vector<uint8_t>			mInput;
+	SocketHandle			mSocket;
+};
+
+// Polls both clients until each has \a count frames or a second passes
+static void receive( FrameClient& udp, vector<FrameSnapshot>& udpFrames, WebSocketClient& ws, vector<FrameSnapshot>& wsFrames,
+					 size_t count, bool& wsOk )
+{
+	for ( int32_t i = 0; i < 1000 && ( udpFrames.size() < count || wsFrames.size() < count ); ++i ) {
+		udp.receive( udpFrames );
+		wsOk = ws.receive( wsFrames ) && wsOk;
+		sleepMilliseconds( 1 );
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	FrameServerRef server = FrameServer::create( FrameServer::Options()
+		.framesPerPacket( 3 ).maxLatency( 0.02 ).queueSize( 4 ).keyFrameInterval( 0 ).webSocketPort( 0 ) );
+	check( server->isRunning() && server->getWebSocketPort() != 0, "server did not start" );
+
+	FrameClientRef udp = FrameClient::create( 0 );
+	check( udp->isOpen() && udp->getPort() != 0, "UDP client did not bind" );
+	server->addUdpClient( "127.0.0.1", udp->getPort() );
+
+	WebSocketClient ws;
+	check( ws.connect( server->getWebSocketPort() ), "WebSocket handshake failed" );
+	for ( int32_t i = 0; i < 1000 && server->getNumClients() < 2; ++i ) {
+		sleepMilliseconds( 1 );
+	}
+	check( server->getNumClients() == 2, "WebSocket client not registered" );
+	if ( gFailures > 0 ) {
+		return 1;
+	}
+
+	// Round trip. The frame count isn't a multiple of framesPerPacket,
+	// so the last packet only goes out on the latency deadline.
+	vector<FrameSnapshot> sent;
+	vector<FrameSnapshot> udpFrames;
+	vector<FrameSnapshot> wsFrames;
+	bool wsOk = true;
+	for ( int32_t i = 0; i < kNumFrames; ++i ) {
+		sent.push_back( makeFrame( 1000 + i ) );
+		server->send( sent.back() );
+		udp->receive( udpFrames );
+		wsOk = ws.receive( wsFrames ) && wsOk;
+		sleepMilliseconds( 1 );
+	}
+	receive( *udp, udpFrames, ws, wsFrames, sent.size(), wsOk );
+
+	check( wsOk, "WebSocket frame failed to decode" );
+	check( udp->getNumRejected() == 0, "UDP frame failed to decode" );
+	check( server->getNumDropped() == 0, "frames dropped during round trip" );
+	check( udpFrames.size() == sent.size(), "UDP client is missing frames" );
+	check( wsFrames.size() == sent.size(), "WebSocket client is missing frames" );
+	float error = 0.0f;
+	for ( size_t i = 0; i < sent.size() && i < udpFrames.size() && i < wsFrames.size(); ++i ) {
+		const FrameSnapshot& u = udpFrames[ i ];
+		const FrameSnapshot& w = wsFrames[ i ];
+		if ( u.mId != sent[ i ].mId || w.mId != sent[ i ].mId || u.mNumHands != 1 || w.mNumHands != 1 ) {
+			check( false, "frame ids or hands differ" );
+			break;
+		}
+		if ( positionError( u, w ) != 0.0f ) {
+			check( false, "UDP and WebSocket frames decode differently" );
+			break;
+		}
+		error = max( error, positionError( u, sent[ i ] ) );
+	}
+	check( error <= kPositionError, "decoded positions exceed quantization error" );
+	printf( "round trip: %d frames, udp %d, websocket %d, max error %.4f mm\n",
+		kNumFrames, (int32_t)udpFrames.size(), (int32_t)wsFrames.size(), error );
+
+	// Overflow. The WebSocket client, now the only one, stops reading,
+	// so its socket fills, its queue overflows and is dropped. Once it
+	// reads again it must decode straight through the key frame that
+	// follows.
+	server->removeUdpClient( "127.0.0.1", udp->getPort() );
+	int64_t id = 1000 + kNumFrames;
+	for ( int32_t i = 0; i < 100000 && server->getNumDropped() == 0; ++i, ++id ) {
+		server->send( makeFrame( id ) );
+		if ( i % 64 == 0 ) {
+			sleepMilliseconds( 1 );
+		}
+	}
+	check( server->getNumDropped() > 0, "WebSocket queue never overflowed" );
+
+	const int64_t lastId	= id + 9;
+	wsFrames.clear();
+	for ( ; id <= lastId; ++id ) {
+		server->send( makeFrame( id ) );
+		sleepMilliseconds( 1 );
+	}
+	for ( int32_t i = 0; i < 5000 && ( wsFrames.empty() || wsFrames.back().mId != lastId ); ++i ) {
+		wsOk = ws.receive( wsFrames ) && wsOk;
+		sleepMilliseconds( 1 );
+	}
+
+	bool ordered = true;
+	for ( size_t i = 1; i < wsFrames.size(); ++i ) {
+		ordered = ordered && wsFrames[ i ].mId > wsFrames[ i - 1 ].mId;
+	}
+	check( wsOk, "WebSocket frame failed to decode after overflow" );
+	check( ordered, "WebSocket frames out of order after overflow" );
+	check( !wsFrames.empty() && wsFrames.back().mId == lastId, "WebSocket client did not resynchronize" );
+	if ( !wsFrames.empty() ) {
+		check( positionError( wsFrames.back(), makeFrame( lastId ) ) <= kPositionError, "resynchronized frame is wrong" );
+	}
+	printf( "overflow: %d frames dropped, websocket resumed at %d\n",
+		(int32_t)server->getNumDropped(), wsFrames.empty() ? -1 : (int32_t)wsFrames.back().mId );
+
+	printf( gFailures == 0 ? "ok\n" : "FAILED\n" );
+	return gFailures == 0 ? 0 : 1;
+}
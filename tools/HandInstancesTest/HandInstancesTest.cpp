@@ -0,0 +1,131 @@
+/*
+	Headless test for HandInstances, the CPU stage of HandRenderer.
+	Console program built by tools/CMakeLists.txt, or by hand:
+
+	g++ -std=c++11 -O2 -I../../src -I$CINDER/include \
+		HandInstancesTest.cpp ../../src/HandInstances.cpp -o HandInstancesTest
+
+	Builds instances from a fixed hand and checks the instance counts,
+	their positions and radii, and that repeated frame ids are skipped.
+	Exits non-zero on failure.
+*/
+
+#include "HandInstances.h"
+
+#include <cstdio>
+
+using namespace ci;
+using namespace LeapMotion;
+using namespace std;
+
+// Arm, wrist to finger base, four knuckles, 20 bones less the thumb's zero length metacarpal
+static const size_t kBonesPerHand	= 1 + 5 + 4 + 19;
+// Elbow and wrist, then five joints per finger
+static const size_t kJointsPerHand	= 2 + 5 * 5;
+
+static int32_t gFailures = 0;
+
+static void check( bool condition, const char* message )
+{
+	if ( !condition ) {
+		printf( "FAILED: %s\n", message );
+		++gFailures;
+	}
+}
+
+// Fingers run along -z from the wrist, 20 mm apart in x, \a offset added throughout
+static HandSnapshot makeHand( int32_t id, const vec3& offset )
+{
+	HandSnapshot hand	= HandSnapshot();
+	hand.mId			= id;
+	hand.mElbowPosition	= offset + vec3( 0.0f, 0.0f, 300.0f );
+	hand.mWristPosition	= offset + vec3( 0.0f, 0.0f, 50.0f );
+	for ( int32_t i = 0; i < 5; ++i ) {
+		vec3 joint = offset + vec3( -40.0f + 20.0f * (float)i, 0.0f, 40.0f );
+		for ( int32_t j = 0; j < 4; ++j ) {
+			BoneSnapshot& bone	= hand.mFingers[ i ].mBones[ j ];
+			bone.mPrevJoint		= joint;
+			if ( i > 0 || j > 0 ) {
+				joint += vec3( 0.0f, 0.0f, -20.0f );
+			}
+			bone.mNextJoint		= joint;
+		}
+	}
+	return hand;
+}
+
+static FrameSnapshot makeFrame( int64_t id, uint32_t numHands )
+{
+	FrameSnapshot frame	= FrameSnapshot();
+	frame.mFields		= FIELD_ARMS | FIELD_BONES;
+	frame.mId			= id;
+	frame.mNumHands		= numHands;
+	for ( uint32_t i = 0; i < numHands; ++i ) {
+		frame.mHands[ i ] = makeHand( (int32_t)i + 1, vec3( 200.0f * (float)i, 100.0f, 0.0f ) );
+	}
+	return frame;
+}
+
+static bool equal( const vec4& a, const vec4& b )
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+static bool hasBone( const vector<HandInstances::Bone>& bones, const vec4& start, const vec4& end )
+{
+	for ( size_t i = 0; i < bones.size(); ++i ) {
+		if ( equal( bones[ i ].mStart, start ) && equal( bones[ i ].mEnd, end ) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int main( int argc, char* argv[] )
+{
+	HandInstances instances;
+	check( instances.getFrameId() == -1, "frame id before the first update" );
+
+	// Counts and transforms
+	const FrameSnapshot frame = makeFrame( 100, 2 );
+	check( instances.update( frame ), "first frame was not built" );
+	check( instances.getFrameId() == 100, "frame id not recorded" );
+
+	const vector<HandInstances::Bone>& bones	= instances.getBones();
+	const vector<HandInstances::Joint>& joints	= instances.getJoints();
+	check( bones.size() == kBonesPerHand * 2, "bone instance count" );
+	check( joints.size() == kJointsPerHand * 2, "joint instance count" );
+
+	const HandSnapshot& hand	= frame.mHands[ 1 ];
+	const float jointRadius		= instances.getJointRadius();
+	const float boneRadius		= instances.getBoneRadius();
+	const vec3 tip				= hand.mFingers[ 4 ].mBones[ 3 ].mNextJoint;
+	check( equal( joints[ kJointsPerHand ], vec4( hand.mElbowPosition, jointRadius ) ), "elbow joint" );
+	check( equal( joints[ kJointsPerHand + 1 ], vec4( hand.mWristPosition, jointRadius ) ), "wrist joint" );
+	check( equal( joints.back(), vec4( tip, jointRadius ) ), "finger tip joint" );
+	check( equal( bones[ kBonesPerHand ].mStart, vec4( hand.mElbowPosition, boneRadius ) ) &&
+		   equal( bones[ kBonesPerHand ].mEnd, vec4( hand.mWristPosition, boneRadius ) ), "arm bone" );
+	check( hasBone( bones, vec4( hand.mFingers[ 1 ].mBones[ 1 ].mPrevJoint, boneRadius ),
+		   vec4( hand.mFingers[ 2 ].mBones[ 1 ].mPrevJoint, boneRadius ) ), "knuckle bone" );
+	check( hasBone( bones, vec4( hand.mFingers[ 4 ].mBones[ 3 ].mPrevJoint, boneRadius ), vec4( tip, boneRadius ) ), "distal bone" );
+	check( !hasBone( bones, vec4( hand.mFingers[ 0 ].mBones[ 0 ].mPrevJoint, boneRadius ),
+		   vec4( hand.mFingers[ 0 ].mBones[ 0 ].mNextJoint, boneRadius ) ), "zero length thumb metacarpal was drawn" );
+
+	// Repeated ids are skipped, and leave the instances alone
+	FrameSnapshot repeated = makeFrame( 100, 1 );
+	check( !instances.update( repeated ), "repeated frame id was rebuilt" );
+	check( bones.size() == kBonesPerHand * 2, "repeated frame id changed the instances" );
+
+	// Changing a radius rebuilds the same frame
+	instances.setJointRadius( 6.0f );
+	check( instances.getFrameId() == -1, "radius change did not invalidate" );
+	check( instances.update( repeated ), "radius change did not rebuild" );
+	check( joints.size() == kJointsPerHand && joints[ 0 ].w == 6.0f, "rebuilt joint radius" );
+
+	// A new id rebuilds, and no hands clears
+	check( instances.update( makeFrame( 101, 0 ) ), "new frame id was not rebuilt" );
+	check( bones.empty() && joints.empty(), "empty frame left instances behind" );
+
+	printf( gFailures == 0 ? "ok\n" : "FAILED\n" );
+	return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+/*
+	Headless test for HandSkin's linear-blend skinning.
+	Console program built by tools/CMakeLists.txt, or by hand:
+
+	g++ -std=c++11 -O2 -pthread -I../../src -I$CINDER/include \
+		HandSkinTest.cpp ../../src/HandSkin.cpp -o HandSkinTest
+
+	Add -DLEAPMOTION_NO_SIMD to test the scalar path; CMake builds
+	both. Checks that identity bones leave the mesh alone, that a
+	rotated and non-uniformly scaled bone moves positions and normals
+	where expected, and that blended and threaded results match a
+	reference computed here. Exits non-zero on failure.
+*/
+
+#include "HandSkin.h"
+#include "Simd.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace ci;
+using namespace LeapMotion;
+using namespace std;
+
+static const float kTolerance = 1e-4f;
+
+static int32_t gFailures = 0;
+
+static void check( bool condition, const char* message )
+{
+	if ( !condition ) {
+		printf( "FAILED: %s\n", message );
+		++gFailures;
+	}
+}
+
+static bool isNear( const vec3& a, const vec3& b )
+{
+	return glm::length( a - b ) <= kTolerance * max( 1.0f, glm::length( b ) );
+}
+
+static bool unit( const vec3& v )
+{
+	return fabs( glm::length( v ) - 1.0f ) <= kTolerance;
+}
+
+static float randomFloat( float low, float high )
+{
+	return low + ( high - low ) * (float)rand() / (float)RAND_MAX;
+}
+
+// Translation * rotation about z by \a angle * scale
+static mat4 makeMatrix( const vec3& translation, float angle, const vec3& scale )
+{
+	float c = cos( angle );
+	float s = sin( angle );
+	return mat4(
+		vec4( c * scale.x, s * scale.x, 0.0f, 0.0f ),
+		vec4( -s * scale.y, c * scale.y, 0.0f, 0.0f ),
+		vec4( 0.0f, 0.0f, scale.z, 0.0f ),
+		vec4( translation, 1.0f ) );
+}
+
+static HandMatrices makeIdentity()
+{
+	HandMatrices matrices;
+	for ( size_t i = 0; i < HandMatrices::kNumBones; ++i ) {
+		matrices.mBones[ i ] = mat4();
+	}
+	return matrices;
+}
+
+// Random positions and unit normals, weighted to \a numJoints joints
+static HandSkin::Mesh makeMesh( size_t count, size_t numJoints )
+{
+	HandSkin::Mesh mesh;
+	for ( size_t i = 0; i < count; ++i ) {
+		HandSkin::Influence influence;
+		for ( size_t j = 0; j < numJoints; ++j ) {
+			influence.mJoints[ j ]	= (uint8_t)( rand() % HandMatrices::kNumBones );
+			influence.mWeights[ j ]	= numJoints == 1 ? 1.0f : randomFloat( 0.1f, 1.0f );
+		}
+		mesh.mInfluences.push_back( influence );
+		mesh.mNormals.push_back( glm::normalize( vec3( randomFloat( -1.0f, 1.0f ), randomFloat( -1.0f, 1.0f ), randomFloat( 0.1f, 1.0f ) ) ) );
+		mesh.mPositions.push_back( vec3( randomFloat( -50.0f, 50.0f ), randomFloat( -50.0f, 50.0f ), randomFloat( -50.0f, 50.0f ) ) );
+	}
+	return mesh;
+}
+
+// Weighted sum of pose * inverse bind, and of the normal matrices
+static void skinReference( const HandSkin::Mesh& mesh, const HandMatrices& bindPose, const HandMatrices& pose,
+						   vector<vec3>* positions, vector<vec3>* normals )
+{
+	positions->clear();
+	normals->clear();
+	for ( size_t i = 0; i < mesh.mPositions.size(); ++i ) {
+		const HandSkin::Influence& influence = mesh.mInfluences[ i ];
+		float sum = 0.0f;
+		for ( size_t j = 0; j < 4; ++j ) {
+			sum += influence.mWeights[ j ];
+		}
+
+		vec3 position;
+		vec3 normal;
+		for ( size_t j = 0; j < 4; ++j ) {
+			if ( influence.mWeights[ j ] == 0.0f ) {
+				continue;
+			}
+			size_t joint	= influence.mJoints[ j ];
+			float w			= influence.mWeights[ j ] / sum;
+			mat4 m			= pose.mBones[ joint ] * glm::inverse( bindPose.mBones[ joint ] );
+			position		+= vec3( m * vec4( mesh.mPositions[ i ], 1.0f ) ) * w;
+			normal			+= glm::transpose( glm::inverse( mat3( m ) ) ) * mesh.mNormals[ i ] * w;
+		}
+		positions->push_back( position );
+		normals->push_back( glm::normalize( normal ) );
+	}
+}
+
+static bool matches( const vector<vec3>& a, const vector<vec3>& b )
+{
+	if ( a.size() != b.size() ) {
+		return false;
+	}
+	for ( size_t i = 0; i < a.size(); ++i ) {
+		if ( !isNear( a[ i ], b[ i ] ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool allUnit( const vector<vec3>& v )
+{
+	for ( size_t i = 0; i < v.size(); ++i ) {
+		if ( !unit( v[ i ] ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main( int argc, char* argv[] )
+{
+#if defined( LEAPMOTION_SSE )
+	printf( "SSE2 path\n" );
+#else
+	printf( "Scalar path\n" );
+#endif
+	srand( 1 );
+
+	vector<vec3> positions;
+	vector<vec3> normals;
+
+	// Identity bones leave the mesh alone, to rounding of the blended weights
+	{
+		HandSkin::Mesh mesh		= makeMesh( 256, 4 );
+		HandMatrices identity	= makeIdentity();
+		HandSkinRef skin		= HandSkin::create( mesh, identity, 1 );
+		skin->update( identity );
+		check( matches( skin->getPositions(), mesh.mPositions ), "identity bones moved positions" );
+		check( matches( skin->getNormals(), mesh.mNormals ), "identity bones changed normals" );
+	}
+
+	// One rotated, non-uniformly scaled bone off a translated bind pose
+	{
+		const size_t joint		= HandSkin::getJointIndex( Leap::Finger::TYPE_INDEX, Leap::Bone::TYPE_PROXIMAL );
+		HandSkin::Mesh mesh;
+		HandSkin::Influence influence;
+		influence.mJoints[ 0 ]	= (uint8_t)joint;
+		influence.mWeights[ 0 ]	= 1.0f;
+		mesh.mInfluences.push_back( influence );
+		mesh.mInfluences.push_back( influence );
+		mesh.mNormals.push_back( glm::normalize( vec3( 1.0f, 1.0f, 0.0f ) ) );
+		mesh.mNormals.push_back( vec3( 0.0f, 0.0f, 1.0f ) );
+		mesh.mPositions.push_back( vec3( 11.0f, 20.0f, 30.0f ) );
+		mesh.mPositions.push_back( vec3( 10.0f, 20.0f, 34.0f ) );
+
+		HandMatrices bindPose			= makeIdentity();
+		bindPose.mBones[ joint ]		= makeMatrix( vec3( 10.0f, 20.0f, 30.0f ), 0.0f, vec3( 1.0f ) );
+		HandMatrices pose				= makeIdentity();
+		pose.mBones[ joint ]			= makeMatrix( vec3( -5.0f, 0.0f, 0.0f ), 1.57079633f, vec3( 2.0f, 1.0f, 0.5f ) );
+
+		HandSkinRef skin = HandSkin::create( mesh, bindPose, 1 );
+		skin->update( pose );
+		positions	= skin->getPositions();
+		normals		= skin->getNormals();
+
+		// (1, 0, 0) scales to (2, 0, 0), rotates to (0, 2, 0); (0, 0, 4) scales to (0, 0, 2)
+		check( isNear( positions[ 0 ], vec3( -5.0f, 2.0f, 0.0f ) ), "rotated and scaled position" );
+		check( isNear( positions[ 1 ], vec3( -5.0f, 0.0f, 2.0f ) ), "scaled position" );
+		// Normal scale is the inverse, (0.5, 1) rotated to (-1, 0.5)
+		check( isNear( normals[ 0 ], glm::normalize( vec3( -1.0f, 0.5f, 0.0f ) ) ), "rotated and scaled normal" );
+		check( isNear( normals[ 1 ], vec3( 0.0f, 0.0f, 1.0f ) ), "scaled normal" );
+		check( allUnit( normals ), "normals are not unit length" );
+	}
+
+	// Four blended joints on random bones, single and threaded
+	{
+		HandSkin::Mesh mesh		= makeMesh( 4096, 4 );
+		HandMatrices bindPose;
+		HandMatrices pose;
+		for ( size_t i = 0; i < HandMatrices::kNumBones; ++i ) {
+			vec3 scale				= vec3( randomFloat( 0.5f, 2.0f ), randomFloat( 0.5f, 2.0f ), randomFloat( 0.5f, 2.0f ) );
+			bindPose.mBones[ i ]	= makeMatrix( vec3( randomFloat( -50.0f, 50.0f ) ), randomFloat( -3.0f, 3.0f ), vec3( 1.0f ) );
+			pose.mBones[ i ]		= makeMatrix( vec3( randomFloat( -50.0f, 50.0f ) ), randomFloat( -3.0f, 3.0f ), scale );
+		}
+		vector<vec3> expectedPositions;
+		vector<vec3> expectedNormals;
+		skinReference( mesh, bindPose, pose, &expectedPositions, &expectedNormals );
+
+		HandSkinRef skin = HandSkin::create( mesh, bindPose, 1 );
+		skin->update( pose );
+		check( matches( skin->getPositions(), expectedPositions ), "blended positions" );
+		check( matches( skin->getNormals(), expectedNormals ), "blended normals" );
+		check( allUnit( skin->getNormals() ), "blended normals are not unit length" );
+
+		HandSkinRef threaded = HandSkin::create( mesh, bindPose, 4 );
+		check( threaded->getNumThreads() == 4, "thread count" );
+		threaded->update( pose );
+		threaded->update( pose );
+		check( threaded->getPositions() == skin->getPositions(), "threaded positions differ" );
+		check( threaded->getNormals() == skin->getNormals(), "threaded normals differ" );
+	}
+
+	printf( gFailures == 0 ? "ok\n" : "FAILED\n" );
+	return gFailures == 0 ? 0 : 1;
+}